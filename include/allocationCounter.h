@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+// COUNT_ALLOCATIONS follows the CMake option of the same name. When it is
+// on, allocationCounter.cpp replaces the global allocation functions to
+// count them, which is how steady state frames are checked for heap
+// allocations. Off, the program keeps the standard library's and nothing
+// is counted.
+#ifndef COUNT_ALLOCATIONS
+#define COUNT_ALLOCATIONS 0
+#endif
+
+// Number of global operator new calls since the program started, always 0
+// without COUNT_ALLOCATIONS
+uint64_t heapAllocations();
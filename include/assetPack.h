@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Asset pack layout, all little endian and read in place:
+//   AssetPackHeader
+//   AssetPackEntry[entryCount], sorted by name hash
+//   name table, NUL terminated names
+//   blobs, each starting on an ALIGNMENT boundary
+struct AssetPackHeader {
+  char magic[4]; // "LGPK"
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t nameBytes;
+  uint64_t entriesOffset;
+  uint64_t namesOffset;
+};
+
+struct AssetPackEntry {
+  uint64_t hash; // hashAssetName() of the name
+  uint64_t offset;
+  uint64_t storedSize;
+  uint64_t size; // after decompression
+  uint32_t nameOffset;
+  uint32_t flags;
+};
+
+static_assert(sizeof(AssetPackHeader) == 32, "pack header layout");
+static_assert(sizeof(AssetPackEntry) == 40, "pack entry layout");
+
+// FNV-1a, 64 bit
+uint64_t hashAssetName(const std::string &name);
+
+// One read only memory mapping of a pack file. Opening costs one open and
+// one mmap; asset bytes are paged in when first touched. Lookups are a
+// binary search over the hashes and safe from any thread once open.
+class AssetPack {
+public:
+  static const uint32_t VERSION = 1;
+  static const uint32_t ALIGNMENT = 64;
+  // the blob is a raw LZ4 block
+  static const uint32_t FLAG_LZ4 = 1;
+
+  AssetPack() = default;
+  ~AssetPack();
+
+  AssetPack(const AssetPack &) = delete;
+  AssetPack &operator=(const AssetPack &) = delete;
+
+  // false when the file is missing or not a pack
+  bool open(const std::string &path);
+  void close();
+  bool isOpen() const { return base != nullptr; }
+
+  bool contains(const std::string &name) const;
+
+  // the asset's bytes: in place in the mapping when stored uncompressed,
+  // otherwise decompressed into scratch. nullptr when missing or corrupt
+  const uint8_t *bytes(const std::string &name, std::vector<uint8_t> &scratch,
+                       size_t &size) const;
+
+  uint32_t entryCount() const { return count; }
+
+private:
+  const uint8_t *base = nullptr;
+  size_t mappedBytes = 0;
+  const AssetPackEntry *entries = nullptr;
+  const char *names = nullptr;
+  uint32_t count = 0;
+  uint32_t nameBytes = 0;
+#ifdef _WIN32
+  void *file = nullptr;
+  void *mapping = nullptr;
+#endif
+
+  const AssetPackEntry *find(const std::string &name) const;
+};
+
+// the pack loaders look in before falling back to loose files
+AssetPack &assetPack();
+
+struct AssetPackInput {
+  std::string name;
+  std::vector<uint8_t> bytes;
+  // false keeps the entry uncompressed so it can be read in place
+  bool compress = true;
+};
+
+// write a pack of inputs; with lz4 an entry that may be compressed is
+// stored compressed when that saves at least an eighth of it
+bool writeAssetPack(const std::string &path,
+                    const std::vector<AssetPackInput> &inputs, bool lz4);
@@ -0,0 +1,9 @@
+#pragma once
+
+// CPU-side microbenchmarks, run with --bench NAME before any window or GL
+// context exists. count scales the workload, 0 picks the default.
+// Returns the process exit code.
+int runBenchmark(const char *name, unsigned int count);
+
+// prints the available benchmark names
+void listBenchmarks();
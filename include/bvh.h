@@ -0,0 +1,57 @@
+#pragma once
+#include "frustumCulling.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy over static object bounds. Nodes are built with
+// a binned surface area heuristic and stored depth first in one array: a
+// node's left child directly follows it and `skip` points just past its
+// subtree. The objects of every subtree are therefore one contiguous range
+// of the reordered index array, so a subtree fully inside the frustum is
+// accepted without visiting it.
+class Bvh {
+public:
+  static const unsigned int MAX_LEAF_OBJECTS = 4;
+
+  struct Node {
+    glm::vec3 min;
+    uint32_t first; // first entry in objectOrder
+    glm::vec3 max;
+    uint32_t skip; // next node after this subtree, node + 1 for leaves
+  };
+
+  struct CullStats {
+    unsigned int nodesVisited = 0;
+    unsigned int objectsTested = 0;
+  };
+
+  void build(const std::vector<glm::vec3> &mins,
+             const std::vector<glm::vec3> &maxs);
+
+  // appends every object whose box intersects the frustum to visible
+  CullStats cull(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+
+  // nearest object hit by the ray, or -1. distance is along direction,
+  // which does not need to be normalized
+  int raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+              float &distance) const;
+
+  size_t nodeCount() const { return nodes.size(); }
+
+private:
+  std::vector<Node> nodes;
+  std::vector<uint32_t> objectOrder;
+  std::vector<glm::vec3> objectMin;
+  std::vector<glm::vec3> objectMax;
+
+  void buildNode(uint32_t first, uint32_t count,
+                 std::vector<glm::vec3> &centroids, unsigned int depth);
+  uint32_t rangeEnd(uint32_t node) const {
+    uint32_t skip = nodes[node].skip;
+    return skip < nodes.size() ? nodes[skip].first
+                               : (uint32_t)objectOrder.size();
+  }
+};
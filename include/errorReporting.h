@@ -1,13 +1,41 @@
 #pragma once
 #include <glad/glad.h>
 
+// GL_ERROR_REPORTING selects whether any of this is compiled in. It follows
+// NDEBUG unless set explicitly, so release builds get empty inline stubs.
+#ifndef GL_ERROR_REPORTING
+#ifdef NDEBUG
+#define GL_ERROR_REPORTING 0
+#else
+#define GL_ERROR_REPORTING 1
+#endif
+#endif
+
+#if GL_ERROR_REPORTING
+
 // https://learnopengl.com/In-Practice/Debugging
 void GLAPIENTRY glDebugOutput(GLenum source, GLenum type, unsigned int id,
                               GLenum severity, GLsizei length,
                               const char *message, const void *userParam);
 
-void enableReportGlErrors();
+// install glDebugOutput on a debug context. Synchronous output reports on the
+// thread that made the call, which is slower but gives usable call stacks
+void enableReportGlErrors(bool synchronous = false);
+
+// start the background writer; until then reports go to stderr
+void createErrorFile(const char *path = "gl_errors.log");
 
-void createErrorFile();
+// flush pending reports, write the suppression totals and stop the writer
+void closeErrorFile();
 
+// queue one line for the log, never waits on file I/O
 void reportError(const char *message);
+
+#else
+
+inline void enableReportGlErrors(bool = false) {}
+inline void createErrorFile(const char * = nullptr) {}
+inline void closeErrorFile() {}
+inline void reportError(const char *) {}
+
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Bump allocator for data that lives for one frame. There is one buffer
+// per frame in flight; nextFrame() at the swap recycles the oldest, so
+// memory handed out stays valid while the GPU may still read it. Each
+// thread carves its own block out of the frame buffer and bumps inside it
+// without atomics. Nothing is freed individually.
+class FrameArena {
+public:
+  static const unsigned int FRAMES = 3;
+  // bytes a thread takes from the frame buffer at a time
+  static const size_t THREAD_BLOCK = 64 * 1024;
+
+  explicit FrameArena(size_t bytesPerFrame = 16 * 1024 * 1024);
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  // never fails; past the frame budget it falls back to the heap and
+  // counts an overflow
+  void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+  template <typename T> T *allocateArray(size_t count) {
+    return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+  }
+
+  // retire this frame and reset the buffer of the oldest one. No other
+  // thread may allocate from the arena while this runs
+  void nextFrame();
+
+  size_t capacity() const { return frameCapacity; }
+  size_t lastFrameBytes() const { return lastBytes; }
+  size_t peakFrameBytes() const { return peakBytes; }
+  uint64_t overflowCount() const { return overflows.load(); }
+
+private:
+  struct Frame {
+    unsigned char *memory = nullptr;
+    std::atomic<size_t> used{0};
+    std::mutex overflowMutex;
+    std::vector<void *> overflow;
+  };
+
+  Frame frames[FRAMES];
+  size_t frameCapacity;
+  unsigned int current = 0;
+  std::atomic<uint64_t> generation;
+
+  size_t lastBytes = 0;
+  size_t peakBytes = 0;
+  std::atomic<uint64_t> overflows{0};
+
+  unsigned char *reserve(size_t bytes);
+  void *allocateOverflow(size_t bytes, size_t alignment);
+  void releaseOverflow(Frame &frame);
+};
+
+// STL allocator handing out frame arena memory, deallocate does nothing
+template <typename T> class FrameAllocator {
+public:
+  using value_type = T;
+
+  explicit FrameAllocator(FrameArena &arena) : arena(&arena) {}
+  template <typename U>
+  FrameAllocator(const FrameAllocator<U> &other) : arena(other.arena) {}
+
+  T *allocate(size_t count) { return arena->allocateArray<T>(count); }
+  void deallocate(T *, size_t) {}
+
+  template <typename U> bool operator==(const FrameAllocator<U> &other) const {
+    return arena == other.arena;
+  }
+  template <typename U> bool operator!=(const FrameAllocator<U> &other) const {
+    return arena != other.arena;
+  }
+
+  FrameArena *arena;
+};
+
+template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
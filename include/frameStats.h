@@ -0,0 +1,85 @@
+#pragma once
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-frame timings kept in a ring buffer of the last N frames. Column 0 is
+// the whole frame, the rest are named phases registered with addPhase().
+// All values are stored in milliseconds.
+class FrameStats {
+public:
+  struct Summary {
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+  };
+
+  // times one phase for as long as it is in scope
+  class Scope {
+  public:
+    Scope(FrameStats &stats, unsigned int phase)
+        : stats(stats), phase(phase), start(Clock::now()) {}
+    ~Scope() { stats.addTime(phase, Clock::now() - start); }
+
+  private:
+    FrameStats &stats;
+    unsigned int phase;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  explicit FrameStats(size_t capacity = 1024);
+
+  // register a phase before the first frame, returns its column
+  unsigned int addPhase(const std::string &name);
+
+  void beginFrame();
+  void endFrame();
+
+  // add to a phase of the current frame, phases may be timed more than once
+  void addTime(unsigned int phase, std::chrono::steady_clock::duration time);
+
+  // charge the time since beginFrame or the previous lap to phase, for
+  // phases that simply follow each other
+  void lap(unsigned int phase);
+
+  std::chrono::steady_clock::duration sinceFrameStart() const {
+    return Clock::now() - frameStart;
+  }
+
+  // frames currently held, at most the capacity
+  size_t frameCount() const { return count; }
+  size_t columnCount() const { return names.size(); }
+  const std::string &columnName(unsigned int column) const {
+    return names[column];
+  }
+
+  Summary summarize(unsigned int column) const;
+
+  // one row per frame held, oldest first
+  void writeCsv(std::ostream &out) const;
+  // summary of every column
+  void writeJson(std::ostream &out) const;
+  // short human readable table
+  void printSummary(std::ostream &out) const;
+
+  // picks CSV or JSON from the extension, false if the file cannot be opened
+  bool writeFile(const std::string &path) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<std::string> names;
+  std::vector<double> current;
+  // capacity rows of names.size() columns
+  std::vector<float> samples;
+  size_t capacity;
+  size_t next = 0;
+  size_t count = 0;
+  Clock::time_point frameStart;
+  Clock::time_point lastLap;
+
+  const float *row(size_t age) const;
+};
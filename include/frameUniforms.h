@@ -0,0 +1,39 @@
+#pragma once
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+
+// Per frame camera data in std140 layout, mirrored by the FrameData block
+// in the shaders. Every member starts on a 16 byte boundary, so the C++
+// struct and the block have the same layout without manual padding.
+struct FrameData {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProjection;
+  glm::vec4 cameraPosition; // w is unused
+  float time;
+  float padding[3];
+};
+
+// Uniform buffer holding FrameData at a fixed binding point. Every program
+// with a FrameData block reads it from there, so the camera is uploaded
+// once per frame however many programs draw.
+class FrameUniforms {
+public:
+  static const GLuint BINDING = 0;
+  static const char *const BLOCK_NAME;
+
+  FrameUniforms();
+  ~FrameUniforms();
+
+  FrameUniforms(const FrameUniforms &) = delete;
+  FrameUniforms &operator=(const FrameUniforms &) = delete;
+
+  // point the program's FrameData block at BINDING, if it has one
+  static void attach(GLuint program);
+
+  // orphan the storage and upload this frame's data
+  void update(const FrameData &data);
+
+private:
+  unsigned int UBO = 0;
+};
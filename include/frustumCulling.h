@@ -0,0 +1,48 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Six normalized planes (a, b, c, d) with the inside where
+// a*x + b*y + c*z + d >= 0, order left, right, bottom, top, near, far.
+struct Frustum {
+  glm::vec4 planes[6];
+};
+
+// Gribb/Hartmann extraction from projection * view
+Frustum extractFrustum(const glm::mat4 &viewProjection);
+
+// bounding spheres in structure of arrays layout
+struct SphereSet {
+  std::vector<float> x, y, z, radius;
+
+  void add(const glm::vec3 &center, float r);
+  void clear();
+  size_t size() const { return x.size(); }
+};
+
+// axis aligned boxes as center and half extents, structure of arrays
+struct AabbSet {
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+
+  void add(const glm::vec3 &min, const glm::vec3 &max);
+  void clear();
+  size_t size() const { return centerX.size(); }
+};
+
+enum class CullPath { Scalar, Sse2, Avx2, Best };
+
+// whether the running CPU and this build can use the path
+bool cullPathSupported(CullPath path);
+const char *cullPathName(CullPath path);
+
+// write the indices of everything at least partly inside the frustum into
+// visible, in ascending order. Returns the visible count
+size_t cullSpheres(const Frustum &frustum, const SphereSet &spheres,
+                   std::vector<uint32_t> &visible,
+                   CullPath path = CullPath::Best);
+size_t cullAabbs(const Frustum &frustum, const AabbSet &boxes,
+                 std::vector<uint32_t> &visible,
+                 CullPath path = CullPath::Best);
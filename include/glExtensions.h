@@ -0,0 +1,138 @@
+#pragma once
+#include "glad/glad.h"
+
+// Entry points and enums newer than the GL 3.3 core that glad was generated
+// for. They are loaded at runtime by loadGlExtensions() and are only safe to
+// call when the matching GLEXT_* flag is set.
+
+// GL_ARB_get_program_binary (core in 4.1)
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+typedef void(APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program,
+                                                   GLsizei bufSize,
+                                                   GLsizei *length,
+                                                   GLenum *binaryFormat,
+                                                   void *binary);
+typedef void(APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program,
+                                                GLenum binaryFormat,
+                                                const void *binary,
+                                                GLsizei length);
+typedef void(APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program,
+                                                    GLenum pname, GLint value);
+extern int GLEXT_ARB_get_program_binary;
+extern PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC glext_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri;
+#define glGetProgramBinary glext_glGetProgramBinary
+#define glProgramBinary glext_glProgramBinary
+#define glProgramParameteri glext_glProgramParameteri
+
+// GL_KHR_debug (core in 4.3)
+#define GL_DEBUG_OUTPUT 0x92E0
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#define GL_CONTEXT_FLAG_DEBUG_BIT 0x00000002
+#define GL_DEBUG_SOURCE_API 0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM 0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER 0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY 0x8249
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#define GL_DEBUG_SOURCE_OTHER 0x824B
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR 0x824E
+#define GL_DEBUG_TYPE_PORTABILITY 0x824F
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#define GL_DEBUG_TYPE_OTHER 0x8251
+#define GL_DEBUG_TYPE_MARKER 0x8268
+#define GL_DEBUG_TYPE_PUSH_GROUP 0x8269
+#define GL_DEBUG_TYPE_POP_GROUP 0x826A
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+typedef void(APIENTRYP PFNGLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROC callback,
+                                                       const void *userParam);
+typedef void(APIENTRYP PFNGLDEBUGMESSAGECONTROLPROC)(GLenum source,
+                                                      GLenum type,
+                                                      GLenum severity,
+                                                      GLsizei count,
+                                                      const GLuint *ids,
+                                                      GLboolean enabled);
+extern int GLEXT_KHR_debug;
+extern PFNGLDEBUGMESSAGECALLBACKPROC glext_glDebugMessageCallback;
+extern PFNGLDEBUGMESSAGECONTROLPROC glext_glDebugMessageControl;
+#define glDebugMessageCallback glext_glDebugMessageCallback
+#define glDebugMessageControl glext_glDebugMessageControl
+
+// GL_ARB_buffer_storage (core in 4.4)
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+typedef void(APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target,
+                                                GLsizeiptr size,
+                                                const void *data,
+                                                GLbitfield flags);
+extern int GLEXT_ARB_buffer_storage;
+extern PFNGLBUFFERSTORAGEPROC glext_glBufferStorage;
+#define glBufferStorage glext_glBufferStorage
+
+// GL_ARB_multi_draw_indirect (core in 4.3), needs GL_ARB_base_instance
+// (core in 4.2) for per draw instance offsets
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+typedef void(APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(
+    GLenum mode, GLenum type, const void *indirect, GLsizei drawcount,
+    GLsizei stride);
+extern int GLEXT_ARB_multi_draw_indirect;
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect;
+#define glMultiDrawElementsIndirect glext_glMultiDrawElementsIndirect
+
+// GL_ARB_compute_shader with GL_ARB_shader_storage_buffer_object (both core
+// in 4.3)
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+typedef void(APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint numGroupsX,
+                                                  GLuint numGroupsY,
+                                                  GLuint numGroupsZ);
+typedef void(APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+extern int GLEXT_ARB_compute_shader;
+extern PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute;
+extern PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier;
+#define glDispatchCompute glext_glDispatchCompute
+#define glMemoryBarrier glext_glMemoryBarrier
+
+// GL_KHR_parallel_shader_compile, or the identical ARB extension. Compiles
+// and links return at once and GL_COMPLETION_STATUS_KHR polls them
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+extern int GLEXT_KHR_parallel_shader_compile;
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR;
+#define glMaxShaderCompilerThreadsKHR glext_glMaxShaderCompilerThreadsKHR
+
+// block compressed texture formats, enums only
+// GL_EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+extern int GLEXT_EXT_texture_compression_s3tc;
+// GL_ARB_texture_compression_bptc (core in 4.2)
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+extern int GLEXT_ARB_texture_compression_bptc;
+// GL_ARB_ES3_compatibility (core in 4.3)
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+extern int GLEXT_ARB_ES3_compatibility;
+
+// returns true when the current context lists the extension
+bool hasGlExtension(const char *name);
+
+// true when the context version is at least major.minor
+bool hasGlVersion(int major, int minor);
+
+// call once after gladLoadGLLoader with the same loader
+void loadGlExtensions(GLADloadproc load);
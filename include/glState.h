@@ -0,0 +1,93 @@
+#pragma once
+#include "glad/glad.h"
+
+#include <cstdint>
+
+// Shadow copy of the GL binding and capability state. Every setter compares
+// against the shadow first and only calls GL when the value changes, which
+// keeps redundant binds away from the driver. All code sharing the context
+// must go through glState() for the state it tracks, or call invalidate()
+// after touching it directly.
+class GlState {
+public:
+  static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+  struct Counters {
+    uint64_t issued = 0;
+    uint64_t elided = 0;
+  };
+
+  GlState() { invalidate(); }
+
+  void useProgram(GLuint program);
+  void bindVertexArray(GLuint vao);
+  void bindFramebuffer(GLenum target, GLuint framebuffer);
+  // GL_ELEMENT_ARRAY_BUFFER is VAO state and always passed through
+  void bindBuffer(GLenum target, GLuint buffer);
+
+  void activeTexture(unsigned int unit);
+  // bind on the current unit
+  void bindTexture(GLenum target, GLuint texture);
+  // bind on a given unit, switching the active unit only if needed
+  void bindTexture(unsigned int unit, GLenum target, GLuint texture);
+
+  // GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE are tracked, others pass through
+  void enable(GLenum capability);
+  void disable(GLenum capability);
+  void depthFunc(GLenum func);
+  void depthMask(GLboolean mask);
+  void blendFunc(GLenum source, GLenum destination);
+
+  // forget everything, the next call of each kind reaches the driver
+  void invalidate();
+
+  // starts a new counting window, lastFrame() then holds the previous one
+  void beginFrame();
+  const Counters &lastFrame() const { return previous; }
+  const Counters &total() const { return totals; }
+
+private:
+  static const GLuint UNKNOWN = 0xffffffffu;
+  static const unsigned int TEXTURE_TARGETS = 4;
+  static const unsigned int BUFFER_TARGETS = 10;
+  static const unsigned int CAPABILITIES = 3;
+
+  GLuint program;
+  GLuint vertexArray;
+  GLuint drawFramebuffer;
+  GLuint readFramebuffer;
+  GLuint buffers[BUFFER_TARGETS];
+  unsigned int activeUnit;
+  GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+  int capabilities[CAPABILITIES]; // -1 unknown, 0 off, 1 on
+  GLenum depthFunction;
+  int depthWrite;
+  GLenum blendSource;
+  GLenum blendDestination;
+
+  Counters current;
+  Counters previous;
+  Counters totals;
+
+  // true if the call has to be made, updates the counters
+  bool change(GLuint &cached, GLuint value) {
+    if (cached == value) {
+      elide();
+      return false;
+    }
+    cached = value;
+    passThrough();
+    return true;
+  }
+  void elide() {
+    current.elided++;
+    totals.elided++;
+  }
+  void passThrough() {
+    current.issued++;
+    totals.issued++;
+  }
+};
+
+// the tracker for the one context this program renders with
+GlState &glState();
@@ -0,0 +1,65 @@
+#pragma once
+#include "glad/glad.h"
+#include "glm/ext/matrix_float4x4.hpp"
+#include "meshBatch.h"
+#include "shader.h"
+
+#include <vector>
+
+class ShaderCompiler;
+struct Frustum;
+struct SphereSet;
+
+// Frustum culling in a compute pass. Instance bounds and matrices live in
+// shader storage buffers; every invocation tests one sphere and appends the
+// matrix of a survivor to the visible buffer, bumping the instance count of
+// a single indirect command with an atomic add. The draw reads that command
+// straight from GL memory, so the visible count never comes back to the CPU.
+// Needs GL 4.3, which llvmpipe provides.
+class GpuCuller {
+public:
+  // must match local_size_x in cull.comp
+  static const unsigned int GROUP_SIZE = 64;
+
+  // false when the context has no compute shaders or indirect draws
+  static bool supported();
+
+  // the program is built by compiler; call programChanged() once adopted
+  explicit GpuCuller(ShaderCompiler &compiler);
+  ~GpuCuller();
+
+  GpuCuller(const GpuCuller &) = delete;
+  GpuCuller &operator=(const GpuCuller &) = delete;
+
+  // replace every instance, bounds[i] belongs to models[i]
+  void setInstances(const SphereSet &bounds,
+                    const std::vector<glm::mat4> &models);
+
+  // reupload the matrices of the same instances after they moved
+  void updateModels(const std::vector<glm::mat4> &models);
+
+  // reset the command to draw mesh with no instances, then cull into it
+  void cull(const Frustum &frustum, const MeshBatch::Mesh &mesh);
+
+  // the command cull() wrote, for GL_DRAW_INDIRECT_BUFFER
+  unsigned int commandBuffer() const { return commands; }
+  // the visible matrices, packed from offset 0, for the instance attributes
+  unsigned int visibleBuffer() const { return visible; }
+  unsigned int instanceCount() const { return count; }
+
+  // the culling program; call programChanged() after the compiler adopted
+  // a build of it
+  Shader &shader() { return program; }
+  void programChanged();
+
+private:
+  Shader program;
+  UniformHandle planesUniform;
+  UniformHandle countUniform;
+
+  unsigned int bounds = 0;
+  unsigned int models = 0;
+  unsigned int visible = 0;
+  unsigned int commands = 0;
+  unsigned int count = 0;
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// GPU time per named pass, measured with GL_TIMESTAMP queries. Each frame
+// writes into its own set of queries and results are collected `latency`
+// frames later, so reading them never waits on the GPU. Results that are
+// still not available by then are dropped and counted.
+class GpuTimer {
+public:
+  struct PassStats {
+    std::string name;
+    uint64_t samples = 0;
+    double totalMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double lastMs = 0.0;
+
+    double meanMs() const { return samples ? totalMs / samples : 0.0; }
+  };
+
+  // brackets one pass for as long as it is in scope
+  class Scope {
+  public:
+    Scope(GpuTimer &timer, unsigned int pass) : timer(timer), pass(pass) {
+      timer.begin(pass);
+    }
+    ~Scope() { timer.end(pass); }
+
+  private:
+    GpuTimer &timer;
+    unsigned int pass;
+  };
+
+  explicit GpuTimer(unsigned int latency = 4);
+  ~GpuTimer();
+
+  GpuTimer(const GpuTimer &) = delete;
+  GpuTimer &operator=(const GpuTimer &) = delete;
+
+  // register passes before the first frame
+  unsigned int addPass(const std::string &name);
+
+  // collects the frame issued `latency` frames ago
+  void beginFrame();
+
+  // collect every frame still in flight, waits for the GPU
+  void finish();
+
+  void begin(unsigned int pass);
+  void end(unsigned int pass);
+
+  const std::vector<PassStats> &passes() const { return stats; }
+  uint64_t droppedFrames() const { return dropped; }
+
+  void printSummary(std::ostream &out) const;
+  void reset();
+
+private:
+  struct FrameQueries {
+    std::vector<GLuint> queries; // begin and end timestamp per pass
+    std::vector<bool> issued;
+    bool pending = false;
+  };
+
+  std::vector<PassStats> stats;
+  std::vector<FrameQueries> frames;
+  unsigned int current = 0;
+  uint64_t dropped = 0;
+
+  void createQueries();
+  void collect(FrameQueries &frame);
+};
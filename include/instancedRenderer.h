@@ -0,0 +1,54 @@
+#pragma once
+#include "glad/glad.h"
+#include "glm/ext/matrix_float4x4.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Draws many copies of one mesh with a single instanced draw call. The
+// per-instance model matrices live in their own VBO and are read by the
+// vertex shader as a mat4 attribute with divisor 1.
+class InstancedRenderer {
+public:
+  // first attribute location of the instance matrix (takes four slots)
+  static const unsigned int MODEL_ATTRIBUTE = 2;
+
+  // attaches the instance buffer to an already configured VAO
+  InstancedRenderer(unsigned int vao, const std::vector<glm::mat4> &models);
+  ~InstancedRenderer();
+
+  InstancedRenderer(const InstancedRenderer &) = delete;
+  InstancedRenderer &operator=(const InstancedRenderer &) = delete;
+
+  // replace the instance data, reallocating only when the count grows
+  void update(const std::vector<glm::mat4> &models);
+  void update(const glm::mat4 *models, unsigned int modelCount);
+
+  // read modelCount matrices from another buffer, e.g. a stream buffer
+  // region, starting at offset. update() switches back to the own buffer
+  void attach(unsigned int buffer, size_t offset, unsigned int modelCount);
+
+  // start the attributes at instance first of the current data, stands in
+  // for a base instance where draws cannot pass one
+  void setFirstInstance(unsigned int first);
+
+  // one glDrawArraysInstanced for every instance
+  void draw(GLenum mode, GLint first, GLsizei vertexCount) const;
+
+  unsigned int instanceCount() const { return count; }
+  unsigned int buffer() const { return instanceVBO; }
+
+private:
+  unsigned int VAO;
+  unsigned int instanceVBO = 0;
+  unsigned int count = 0;
+  unsigned int capacity = 0;
+
+  // where the instance data starts, and where the attributes point now
+  unsigned int sourceBuffer = 0;
+  size_t sourceOffset = 0;
+  unsigned int pointedBuffer = 0;
+  size_t pointedOffset = 0;
+
+  void pointAttributes(unsigned int buffer, size_t offset);
+};
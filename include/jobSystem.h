@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing scheduler. Every worker owns a Chase-Lev deque: it pushes
+// and pops jobs at the bottom, idle workers steal from the top of someone
+// else's. The thread that creates the system is worker 0 and only runs
+// jobs while it waits on a counter. Threads outside the system submit
+// through a locked queue, and run jobs from it while they wait.
+class JobSystem {
+  struct Job;
+
+public:
+  // number of jobs still to finish; a job can also wait for one to reach
+  // zero before it starts
+  class Counter {
+  public:
+    bool done() const { return value.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class JobSystem;
+    std::atomic<int> value{0};
+    std::mutex mutex;
+    std::vector<Job *> waiting;
+  };
+
+  // workerCount 0 uses one thread per hardware thread, the creating thread
+  // included
+  explicit JobSystem(unsigned int workerCount = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // queue a job, counter (optional) drops by one once it has run
+  void run(std::function<void()> job, Counter *counter = nullptr);
+
+  // queue a job that starts only after dependency reaches zero
+  void runAfter(Counter &dependency, std::function<void()> job,
+                Counter *counter = nullptr);
+
+  // run jobs until counter reaches zero. A counter may only be destroyed
+  // after a wait on it has returned
+  void wait(Counter &counter);
+
+  // call body on subranges of [begin, end) of at most grain items, split
+  // in halves so thieves take large pieces, and return when all are done
+  void parallelFor(size_t begin, size_t end, size_t grain,
+                   const std::function<void(size_t, size_t)> &body);
+
+  unsigned int threadCount() const { return (unsigned int)deques.size(); }
+
+private:
+  // bounded Chase-Lev deque of job pointers; a full deque makes the owner
+  // run the job itself
+  class Deque {
+  public:
+    static const int64_t CAPACITY = 4096;
+
+    bool push(Job *job);
+    Job *pop();
+    Job *steal();
+
+  private:
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::atomic<Job *> jobs[CAPACITY];
+  };
+
+  std::vector<std::unique_ptr<Deque>> deques;
+  std::vector<std::thread> workers;
+
+  // submissions from threads that are not workers
+  std::mutex injectedMutex;
+  std::deque<Job *> injected;
+  std::atomic<size_t> injectedCount{0};
+
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::atomic<int> sleeping{0};
+  std::atomic<bool> stopping{false};
+
+  void workerLoop(unsigned int index);
+  void schedule(Job *job);
+  Job *findJob(unsigned int index, uint32_t &seed);
+  Job *findForeignJob(uint32_t &seed);
+  Job *popInjected();
+  void execute(Job *job);
+};
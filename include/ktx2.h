@@ -0,0 +1,45 @@
+#pragma once
+#include "textureCompression.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One 2D texture in a KTX2 file: block compressed levels, no array layers,
+// faces or supercompression. Levels are kept in mip order, level 0 first;
+// the file itself stores them smallest first as the format requires.
+struct Ktx2Texture {
+  BlockFormat format = BlockFormat::Bc1;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // KTXorientation: "rd" when the first row is the top of the image, "ru"
+  // when it is the bottom like GL expects
+  std::string orientation = "rd";
+  std::vector<std::vector<uint8_t>> levels;
+};
+
+// one level inside bytes owned by someone else
+struct Ktx2Level {
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+};
+
+// the same texture read in place, its levels point into the parsed bytes
+struct Ktx2View {
+  BlockFormat format = BlockFormat::Bc1;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::string orientation = "rd";
+  std::vector<Ktx2Level> levels;
+};
+
+// false and an error on stdout when the file cannot be written or read
+bool writeKtx2(const std::string &path, const Ktx2Texture &texture);
+bool readKtx2(const std::string &path, Ktx2Texture &texture);
+// read the file into bytes and view it there
+bool readKtx2(const std::string &path, std::vector<uint8_t> &bytes,
+              Ktx2View &view);
+// view bytes already in memory without copying, they have to outlive the
+// view. name is only used for errors
+bool parseKtx2(const uint8_t *data, size_t size, const std::string &name,
+               Ktx2View &view);
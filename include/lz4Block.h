@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Raw LZ4 block format, no frame header or checksums; the caller stores
+// the uncompressed size. Greedy single probe matching, which trades ratio
+// for a compressor small enough to live here.
+
+// append the compressed form of source to out, returns its size
+size_t lz4Compress(const uint8_t *source, size_t size,
+                   std::vector<uint8_t> &out);
+
+// decode exactly outSize bytes, false on malformed or truncated input
+bool lz4Decompress(const uint8_t *source, size_t size, uint8_t *out,
+                   size_t outSize);
@@ -0,0 +1,86 @@
+#pragma once
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class InstancedRenderer;
+
+// one draw as glMultiDrawElementsIndirect reads it from the indirect buffer
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+// Meshes packed into one shared vertex buffer and one index buffer behind a
+// single VAO. A frame's draws become an array of indirect commands issued
+// with one glMultiDrawElementsIndirect on GL 4.3, or one
+// glDrawElementsInstancedBaseVertex per command otherwise. Per draw data is
+// found through baseInstance: instanced attributes start reading at it, so
+// the shaders need neither gl_DrawID nor anything newer than GLSL 3.30.
+class MeshBatch {
+public:
+  // position (3 floats) and texture coordinate (2 floats)
+  static const unsigned int VERTEX_FLOATS = 5;
+
+  struct Mesh {
+    GLuint firstIndex;
+    GLuint indexCount;
+    GLint baseVertex;
+  };
+
+  MeshBatch();
+  ~MeshBatch();
+
+  MeshBatch(const MeshBatch &) = delete;
+  MeshBatch &operator=(const MeshBatch &) = delete;
+
+  // append a mesh before upload(), returns its id
+  unsigned int addMesh(const std::vector<float> &vertices,
+                       const std::vector<uint32_t> &indices);
+
+  // create the shared buffers from every mesh added so far
+  void upload();
+
+  // drop this frame's commands
+  void clear() {
+    commands.clear();
+    externalCommands = 0;
+  }
+
+  // draw instanceCount instances of mesh, reading their per instance data
+  // from firstInstance on
+  void add(unsigned int mesh, GLuint instanceCount, GLuint firstInstance);
+
+  // draw drawCount commands a GPU pass wrote into buffer instead of the
+  // ones added here, until the next clear(). Needs indirect()
+  void drawFrom(unsigned int buffer, GLsizei drawCount);
+
+  // issue every command; instances owns the per instance attributes and is
+  // re-pointed per command when base instances are unavailable
+  void draw(GLenum mode, InstancedRenderer &instances);
+
+  // true when draw() uses glMultiDrawElementsIndirect
+  bool indirect() const;
+
+  unsigned int vertexArray() const { return VAO; }
+  const Mesh &mesh(unsigned int id) const { return meshes[id]; }
+
+private:
+  unsigned int VAO = 0;
+  unsigned int VBO = 0;
+  unsigned int EBO = 0;
+  unsigned int indirectBuffer = 0;
+  size_t indirectCapacity = 0;
+  unsigned int externalCommands = 0;
+  GLsizei externalCount = 0;
+
+  std::vector<Mesh> meshes;
+  std::vector<float> vertexData;
+  std::vector<uint32_t> indexData;
+  std::vector<DrawElementsIndirectCommand> commands;
+};
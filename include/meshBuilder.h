@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// vertices of vertexFloats floats each, indexed as triangles
+struct IndexedMesh {
+  std::vector<float> vertices;
+  std::vector<uint32_t> indices;
+};
+
+struct MeshBuildStats {
+  size_t inputVertices = 0;
+  size_t outputVertices = 0;
+  // average cache misses per triangle before and after reordering
+  float acmrBefore = 0.0f;
+  float acmrAfter = 0.0f;
+};
+
+// FIFO size used for ACMR, close to what GPUs expose to indices
+const unsigned int ACMR_CACHE_SIZE = 16;
+
+// turn a triangle list of expanded vertices into an indexed mesh, merging
+// vertices whose floats are bit identical
+IndexedMesh weldVertices(const std::vector<float> &vertices,
+                         unsigned int vertexFloats);
+
+// reorder the triangles so vertices are reused while still in the post
+// transform cache, after Tom Forsyth's linear speed vertex cache
+// optimisation
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+// renumber vertices in the order the indices first use them, so the vertex
+// fetch walks the buffer front to back
+void optimizeVertexFetch(IndexedMesh &mesh, unsigned int vertexFloats);
+
+// average cache miss ratio of a FIFO cache of cacheSize entries
+float computeAcmr(const std::vector<uint32_t> &indices, size_t vertexCount,
+                  unsigned int cacheSize = ACMR_CACHE_SIZE);
+
+// weld, then reorder for the vertex cache and vertex fetch. The ACMR before
+// is that of the welded mesh in its original triangle order; the expanded
+// list misses on every vertex, 3.0
+IndexedMesh buildIndexedMesh(const std::vector<float> &vertices,
+                             unsigned int vertexFloats,
+                             MeshBuildStats *stats = nullptr);
@@ -0,0 +1,30 @@
+#pragma once
+#include "glad/glad.h"
+
+// Framebuffer object with a color and a depth renderbuffer, used when
+// rendering without a visible window.
+class OffscreenTarget {
+public:
+  OffscreenTarget(int width, int height);
+  ~OffscreenTarget();
+
+  OffscreenTarget(const OffscreenTarget &) = delete;
+  OffscreenTarget &operator=(const OffscreenTarget &) = delete;
+
+  // false if the driver rejected the attachment combination
+  bool complete() const { return isComplete; }
+
+  // make this the draw and read framebuffer and set the viewport
+  void bind() const;
+
+  int width() const { return targetWidth; }
+  int height() const { return targetHeight; }
+
+private:
+  unsigned int FBO = 0;
+  unsigned int colorRBO = 0;
+  unsigned int depthRBO = 0;
+  int targetWidth;
+  int targetHeight;
+  bool isComplete = false;
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries. Entries are keyed by a hash of
+// the shader sources and the driver vendor/renderer/version strings, so a
+// driver update or a shader edit simply misses and falls back to compiling.
+class ProgramCache {
+public:
+  explicit ProgramCache(const std::string &directory);
+
+  // false when the context cannot retrieve program binaries
+  bool enabled() const { return supported; }
+
+  // key for a set of sources on the current driver
+  uint64_t makeKey(const std::string &vertexCode,
+                   const std::string &fragmentCode) const;
+
+  // loads a cached binary into program, true if it linked
+  bool load(unsigned int program, uint64_t key) const;
+
+  // writes the binary of a linked program, it must have been linked with
+  // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+  void store(unsigned int program, uint64_t key) const;
+
+private:
+  std::string directory;
+  uint64_t driverHash = 0;
+  bool supported = false;
+
+  std::string entryPath(uint64_t key) const;
+};
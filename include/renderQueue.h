@@ -0,0 +1,115 @@
+#pragma once
+#include "glad/glad.h"
+#include "glm/ext/matrix_float4x4.hpp"
+#include "shader.h"
+
+#include <cstdint>
+#include <vector>
+
+class InstancedRenderer;
+class MeshBatch;
+
+// Collects draws for a frame, sorts them by a packed 64-bit key and issues
+// them so that draws sharing a program, texture set and VAO end up next to
+// each other. Key layout, most significant first:
+//   pass 4 | program 12 | texture set 12 | vao 12 | depth 24
+class RenderQueue {
+public:
+  static const uint32_t NO_MODEL = 0xffffffffu;
+  static const uint16_t NO_BATCH = 0xffff;
+
+  // what changed between consecutive draws while walking the queue
+  struct ExecuteStats {
+    unsigned int draws = 0;
+    unsigned int programChanges = 0;
+    unsigned int textureChanges = 0;
+    unsigned int vaoChanges = 0;
+
+    unsigned int stateChanges() const {
+      return programChanges + textureChanges + vaoChanges;
+    }
+  };
+
+  // compact per-draw data, the key lives next to it in the sort array
+  struct DrawItem {
+    uint16_t program;
+    uint16_t textureSet;
+    uint16_t vao;
+    uint16_t mode;
+    uint16_t batch; // index of a mesh batch drawing the item, or NO_BATCH
+    GLint first;
+    GLsizei count;
+    GLsizei instances;
+    uint32_t model; // index into the frame's matrices or NO_MODEL
+  };
+
+  static uint64_t makeKey(unsigned int pass, unsigned int program,
+                          unsigned int textureSet, unsigned int vao,
+                          float depth);
+
+  // registration, returns the index used in submit()
+  unsigned int addProgram(const Shader &shader);
+  unsigned int addTextureSet(const std::vector<GLuint> &textures);
+  unsigned int addVertexArray(GLuint vao);
+  // re-read a registered program after its shader was rebuilt
+  void updateProgram(unsigned int program, const Shader &shader);
+  // a batch sorts under its own VAO and issues its commands as one item
+  unsigned int addBatch(MeshBatch &batch, InstancedRenderer &instances);
+
+  // drops the submitted draws but keeps the memory
+  void clear();
+
+  // depth is the normalized view depth in [0, 1], nearer sorts first
+  void submit(unsigned int pass, unsigned int program,
+              unsigned int textureSet, unsigned int vao, float depth,
+              GLenum mode, GLint first, GLsizei count, GLsizei instances = 1);
+  void submit(unsigned int pass, unsigned int program,
+              unsigned int textureSet, unsigned int vao, float depth,
+              GLenum mode, GLint first, GLsizei count, GLsizei instances,
+              const glm::mat4 &model);
+
+  // draw everything queued in the batch
+  void submitBatch(unsigned int pass, unsigned int program,
+                   unsigned int textureSet, unsigned int batch, float depth,
+                   GLenum mode, const glm::mat4 &model);
+
+  // LSD radix sort of the keys, stable for equal keys
+  void sort();
+
+  // issue every draw in sorted order (or submission order before sort())
+  ExecuteStats execute() const;
+
+  // the same walk without touching GL, for measuring state churn
+  ExecuteStats simulate() const;
+
+  size_t size() const { return entries.size(); }
+
+private:
+  struct Entry {
+    uint64_t key;
+    uint32_t item;
+  };
+
+  struct Program {
+    GLuint id;
+    UniformHandle model;
+  };
+
+  struct Batch {
+    MeshBatch *batch;
+    InstancedRenderer *instances;
+    unsigned int vao;
+  };
+
+  std::vector<Program> programs;
+  std::vector<std::vector<GLuint>> textureSets;
+  std::vector<GLuint> vertexArrays;
+  std::vector<Batch> batches;
+
+  std::vector<Entry> entries;
+  std::vector<Entry> scratch;
+  std::vector<DrawItem> items;
+  std::vector<glm::mat4> models;
+
+  template <bool issue> ExecuteStats walk() const;
+};
@@ -2,26 +2,109 @@
 #include "glad/glad.h"
 #include "glm/ext/matrix_float4x4.hpp"
 
+#include <cstdint>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
+
+// FNV-1a hash of a uniform name, usable at compile time
+constexpr uint32_t hashUniformName(const char *name, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// a uniform name reduced to its hash, e.g. "model"_u
+struct UniformName {
+  uint32_t hash;
+};
+
+constexpr UniformName operator""_u(const char *name, size_t length) {
+  return UniformName{hashUniformName(name, length)};
+}
+
+// resolved uniform location; -1 means the uniform is not active
+struct UniformHandle {
+  GLint location = -1;
+
+  bool valid() const { return location >= 0; }
+};
+
+class ShaderCompiler;
 
 class Shader {
 public:
   // the program ID;
   unsigned int ID;
 
-  // Constructor reads and builds shaders
-  Shader(const char *vertexPath, const char *fragmentPath);
+  // queue the build on compiler, which reads the sources through
+  // shaderPreprocessor() and reuses its program cache. ID stays 0 and no
+  // uniform resolves until the compiler adopts the linked program; a
+  // Blocking compiler's finish() waits for that. defines are inserted into
+  // both stages, see ShaderPreprocessor
+  Shader(const char *vertexPath, const char *fragmentPath,
+         ShaderCompiler &compiler,
+         const std::vector<std::string> &defines = std::vector<std::string>());
+  // compute program from a single stage; needs GLEXT_ARB_compute_shader
+  Shader(const char *computePath, ShaderCompiler &compiler);
+
+  bool ready() const { return ID != 0; }
 
   void use(); // use /activate the shader
 
+  // the files the program was built from, includes last
+  std::vector<std::string> sourcePaths() const;
+
+  // uniform lookup, resolved from the table built after linking
+  UniformHandle uniform(UniformName name) const;
+  UniformHandle uniform(const std::string &name) const;
+
+  // handle based uniform functions, no lookup at all
+  void setBool(UniformHandle handle, bool value) const;
+  void setInt(UniformHandle handle, int value) const;
+  void setFloat(UniformHandle handle, float value) const;
+  void setMat4(UniformHandle handle, const glm::mat4 &matrix) const;
+
   // utility uniform functions
   void setBool(const std::string &name, bool value) const;
   void setInt(const std::string &name, int value) const;
   void setFloat(const std::string &name, float value) const;
   float getFloat(const std::string &name) const;
   void setMat4(const std::string &name, glm::mat4 matrix) const;
+
+private:
+  friend class ShaderCompiler;
+
+  struct UniformSlot {
+    uint32_t hash = 0;
+    GLint location = -1;
+  };
+
+  struct Source {
+    GLenum type;
+    std::string path;
+  };
+
+  // open addressed table, capacity is a power of two
+  std::vector<UniformSlot> uniforms;
+
+  std::vector<Source> sources;
+  std::vector<std::string> defines;
+  // files the sources included in their last read
+  std::vector<std::string> includes;
+
+  void reflectUniforms();
+
+  // the preprocessed code of every source, from the asset pack first
+  // unless fromDisk; an empty string stands for a file that could not be
+  // read
+  std::vector<std::string> readSources(bool fromDisk);
+
+  static const char *stageName(GLenum type);
 };
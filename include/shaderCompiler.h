@@ -0,0 +1,130 @@
+#pragma once
+#include "glad/glad.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct GLFWwindow;
+class ProgramCache;
+class Shader;
+
+// Builds programs in batches without the GL thread waiting on the driver.
+// submit() hands over a program and returns at once, so every program of a
+// scene compiles while its assets load; update() later adopts the programs
+// that are done. With GL_KHR_parallel_shader_compile the compile and link
+// calls are issued right away, the driver's threads do the work and
+// GL_COMPLETION_STATUS_KHR is polled. Without it one worker thread builds
+// the programs on a hidden context sharing objects with the window's, and
+// the GL thread only picks up the finished names. Cached binaries load
+// directly either way.
+class ShaderCompiler {
+public:
+  enum class Mode {
+    Parallel, // GL_KHR_parallel_shader_compile
+    Worker,   // shared context on a worker thread
+    Blocking  // no shared context, submit() builds right away
+  };
+
+  // per program, in the order the programs were adopted. The parallel
+  // times are taken when update() notices, so they are upper bounds at the
+  // rate it is called
+  struct Timing {
+    std::string name; // the source files
+    double compileMs = 0.0;
+    double linkMs = 0.0;
+    bool cached = false; // loaded from the program cache instead
+    bool linked = false;
+  };
+
+  // the programs are used in window's context; cache may be null
+  explicit ShaderCompiler(GLFWwindow *window,
+                          const ProgramCache *cache = nullptr);
+  ~ShaderCompiler();
+
+  ShaderCompiler(const ShaderCompiler &) = delete;
+  ShaderCompiler &operator=(const ShaderCompiler &) = delete;
+
+  Mode mode() const { return buildMode; }
+
+  // queue a build of shader from its sources, the asset pack first. The
+  // Shader constructors taking a compiler call this; shader must stay put
+  // until the build is adopted
+  void submit(Shader &shader);
+
+  // rebuild shader from its loose files. The current program stays in use
+  // until update() swaps the new one in, a failed rebuild keeps it and a
+  // second call drops an unfinished rebuild
+  void reload(Shader &shader);
+
+  // GL thread, between frames: adopt every finished program. True when a
+  // shader's ID changed; its uniform values start over and handles must be
+  // looked up again
+  bool update();
+
+  // block until everything submitted is adopted
+  void finish();
+
+  unsigned int pending() const { return (unsigned int)jobs.size(); }
+
+  const std::vector<Timing> &timings() const { return finished; }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Job {
+    Shader *shader;
+    bool reload;
+    // a later reload of the same shader replaces this one
+    bool superseded = false;
+    std::vector<GLenum> types;
+    std::vector<std::string> code;
+    uint64_t cacheKey = 0;
+    unsigned int program = 0;
+    std::vector<unsigned int> stages;
+    Clock::time_point start;
+    // every stage reported completion, parallel mode only
+    bool compiled = false;
+    // errors collected off the GL thread, printed on adoption
+    std::string log;
+    Timing timing;
+    // guarded by mutex in worker mode
+    bool done = false;
+  };
+
+  Mode buildMode = Mode::Blocking;
+  const ProgramCache *cache;
+
+  // jobs not adopted yet, in submission order
+  std::vector<std::unique_ptr<Job>> jobs;
+  std::vector<Timing> finished;
+
+  GLFWwindow *context = nullptr;
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable jobReady;
+  std::deque<Job *> queue;
+  bool stopping = false;
+
+  void enqueue(Shader &shader, bool reload);
+  // issue the GL calls without waiting for any of them
+  void submitStages(Job &job);
+  void submitLink(Job &job);
+  // the status queries wait when the work is not done yet
+  void checkStages(Job &job);
+  void checkLink(Job &job);
+  // everything after the link, on the thread that built the program
+  void release(Job &job);
+  // the whole build, waiting on each step
+  void build(Job &job);
+  // parallel mode: true once the driver is done with job
+  bool poll(Job &job);
+  bool adopt(Job &job);
+  void workerLoop();
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Assembles the GLSL handed to the compiler. #include "file" lines are
+// replaced by the file, its path taken relative to the including one, and
+// each file goes in at most once per stage. #define lines for the given
+// names ("NAME" or "NAME value") go right after #version. #line directives
+// keep compiler messages on the right line, the source string number being
+// the file's index in the list process() returns.
+//
+// Files are read once, from the asset pack first or the source directory
+// when one is set, and kept, so the variants of a shader and shaders
+// sharing an include reuse them. Not
+// thread safe; Shader and ShaderCompiler use it from the GL thread.
+class ShaderPreprocessor {
+public:
+  // the expanded code of path, or an empty string when a file could not be
+  // read. files receives path and everything it included, in order of
+  // first inclusion. fromDisk skips the pack and the cache and refreshes
+  // the cached copies, for hot reload
+  std::string process(const std::string &path,
+                      const std::vector<std::string> &defines, bool fromDisk,
+                      std::vector<std::string> &files);
+
+  // drop every cached file
+  void clear() { cache.clear(); }
+
+  // read every file from directory instead of the pack and the working
+  // directory, for hot reload from the source tree. Empty restores both
+  void setSourceDirectory(const std::string &directory);
+
+  // where path is read from on disk
+  std::string diskPath(const std::string &path) const {
+    return sourceDirectory + path;
+  }
+
+private:
+  std::unordered_map<std::string, std::string> cache;
+  std::string sourceDirectory;
+
+  const std::string *load(const std::string &path, bool fromDisk);
+  bool expand(const std::string &path, const std::vector<std::string> *defines,
+              bool fromDisk, std::vector<std::string> &files,
+              std::string &out);
+};
+
+// the one Shader reads its sources through
+ShaderPreprocessor &shaderPreprocessor();
@@ -0,0 +1,47 @@
+#pragma once
+#include "shader.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ShaderCompiler;
+
+// Compile time permutations of one vertex and fragment shader pair. Bit i
+// of a key defines options[i] in both stages, so a feature is switched by
+// #ifdef instead of a uniform branch. A variant is handed to the compiler
+// the first time it is asked for and kept from then on; it is not ready()
+// until the compiler has adopted it.
+class ShaderVariants {
+public:
+  static const unsigned int MAX_OPTIONS = 32;
+
+  ShaderVariants(const char *vertexPath, const char *fragmentPath,
+                 const std::vector<std::string> &options,
+                 ShaderCompiler &compiler);
+
+  ShaderVariants(const ShaderVariants &) = delete;
+  ShaderVariants &operator=(const ShaderVariants &) = delete;
+
+  // the variant for key, queued for building on first use. Bits past the
+  // last option are ignored; the reference stays valid as long as this
+  // object
+  Shader &get(uint32_t key);
+
+  // the options key turns on
+  std::vector<std::string> defines(uint32_t key) const;
+
+  // variants built or queued so far
+  size_t size() const { return variants.size(); }
+
+private:
+  std::string vertexPath;
+  std::string fragmentPath;
+  std::vector<std::string> options;
+  ShaderCompiler &compiler;
+  uint32_t validBits;
+
+  std::unordered_map<uint32_t, std::unique_ptr<Shader>> variants;
+};
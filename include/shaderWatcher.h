@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <vector>
+
+class Shader;
+class ShaderCompiler;
+
+// the shaders directory of the source tree, set by CMake, which hot reload
+// reads and watches instead of the copies next to the executable. Empty
+// falls back to the working directory
+#ifndef SHADER_SOURCE_DIR
+#define SHADER_SOURCE_DIR ""
+#endif
+
+// Hot reload for shaders whose source files change on disk. Files are
+// looked for where shaderPreprocessor() reads them, see
+// ShaderPreprocessor::setSourceDirectory. On Linux one inotify descriptor
+// watches the directories holding the files, so saving
+// through a rename is seen as well as writing in place. update() drains the
+// queued events without blocking and hands one rebuild per changed shader
+// to the compiler, whose update() swaps the programs in once they link.
+// Elsewhere nothing is watched.
+class ShaderWatcher {
+public:
+  explicit ShaderWatcher(ShaderCompiler &compiler);
+  ~ShaderWatcher();
+
+  ShaderWatcher(const ShaderWatcher &) = delete;
+  ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+  // false when the platform has no inotify or it ran out of instances
+  bool available() const { return fd >= 0; }
+
+  // watch every source and include of shader, which must outlive the
+  // watcher. Adding a shader again only watches files it did not use before
+  void add(Shader &shader);
+
+  // start rebuilding the shaders whose files were saved since the last call
+  void update();
+
+private:
+  struct File {
+    int watch;
+    std::string name;
+    Shader *shader;
+  };
+
+  ShaderCompiler &compiler;
+  int fd = -1;
+  std::vector<File> files;
+  std::vector<Shader *> changed;
+
+  // add the files of shader not watched for it yet
+  void watch(Shader &shader);
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ring buffer for data the CPU writes every frame and the GPU reads once,
+// like per draw matrices or dynamic vertices. With ARB_buffer_storage the
+// buffer is mapped persistently and coherently, split into one region per
+// frame in flight, and each region is fenced; writes land in GL memory with
+// no driver side copy. On plain GL 3.3 writes go to client memory and
+// flush() uploads them with glBufferSubData into orphaned storage.
+class StreamBuffer {
+public:
+  static const unsigned int FRAMES = 3;
+
+  struct Stats {
+    uint64_t stalls = 0; // frames that had to wait on their region's fence
+    double stallMs = 0.0;
+  };
+
+  StreamBuffer(GLenum target, size_t bytesPerFrame);
+  ~StreamBuffer();
+
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  // wait until the GPU is done with this frame's region
+  void beginFrame();
+
+  // room for bytes in this frame's region, nullptr when it is full.
+  // offset is where the data starts in buffer()
+  void *allocate(size_t bytes, size_t alignment, size_t &offset);
+
+  // make everything allocated so far visible to GL, call before drawing
+  // with it. Free when the buffer is mapped
+  void flush();
+
+  // fence this frame's region
+  void endFrame();
+
+  bool persistent() const { return mapped != nullptr; }
+  unsigned int buffer() const { return name; }
+  size_t regionSize() const { return bytesPerRegion; }
+  const Stats &stats() const { return stallStats; }
+
+private:
+  GLenum target;
+  unsigned int name = 0;
+  size_t bytesPerRegion;
+
+  unsigned char *mapped = nullptr;
+  GLsync fences[FRAMES] = {};
+  unsigned int region = 0;
+  size_t head = 0;
+
+  // fallback path: this frame's data before it is uploaded
+  std::vector<unsigned char> staging;
+  size_t flushed = 0;
+
+  Stats stallStats;
+};
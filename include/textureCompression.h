@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Block compressed formats texbake writes and TextureLoader uploads. Each
+// packs a 4x4 texel block into blockBytes() bytes. The codecs are plain CPU
+// code without GL so the tool and the loader share them.
+enum class BlockFormat { Bc1, Bc3, Bc7, Etc2Rgb, Etc2Rgba };
+
+// short name used on the command line and in baked file names, e.g. "bc7"
+const char *blockFormatName(BlockFormat format);
+bool parseBlockFormat(const char *name, BlockFormat &format);
+
+size_t blockBytes(BlockFormat format);
+bool blockFormatHasAlpha(BlockFormat format);
+
+// VkFormat stored in KTX2 headers
+uint32_t blockVkFormat(BlockFormat format);
+bool blockFormatFromVk(uint32_t vkFormat, BlockFormat &format);
+
+// bytes of one compressed level
+size_t compressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// RGBA8 pixels, rows top to bottom
+struct Image {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint8_t> rgba;
+};
+
+// half size box filtered copy, odd sizes repeat their last row or column
+Image downsample(const Image &image);
+
+// every level down to 1x1, level 0 first
+std::vector<Image> buildMipChain(const Image &image);
+
+// partial blocks at the right and bottom edges repeat the last column and
+// row. The BC7 encoder only writes mode 6 and the ETC2 encoder only the
+// ETC1 compatible modes, which is also all the decoders understand
+std::vector<uint8_t> compressImage(BlockFormat format, const Image &image);
+Image decompressImage(BlockFormat format, const uint8_t *blocks,
+                      uint32_t width, uint32_t height);
+
+// peak signal to noise ratio of the first channels of two equally sized
+// images in dB, infinite when they match
+double psnr(const Image &a, const Image &b, unsigned int channels);
@@ -0,0 +1,87 @@
+#pragma once
+#include "glad/glad.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes images on a pool of worker threads and uploads them on the GL
+// thread. load() hands back a texture name right away that shows a
+// placeholder texel until update() has uploaded the decoded image.
+// When texbake has left a <name>.<format>.ktx2 next to the image in a
+// format the GPU samples, its prebuilt levels are uploaded instead.
+class TextureLoader {
+public:
+  // workerCount 0 uses one worker per hardware thread
+  explicit TextureLoader(unsigned int workerCount = 0);
+  ~TextureLoader();
+
+  TextureLoader(const TextureLoader &) = delete;
+  TextureLoader &operator=(const TextureLoader &) = delete;
+
+  // queue an image for decoding, must be called on the GL thread
+  unsigned int load(const std::string &path, bool flipVertically = false);
+
+  // upload finished images, at most maxUploadBytes per call (0 = no limit).
+  // Returns the number of textures uploaded, GL thread only
+  unsigned int update(size_t maxUploadBytes = 0);
+
+  // block until every queued image is decoded and uploaded
+  void finish();
+
+  // textures queued but not uploaded yet
+  unsigned int pending() const { return pendingCount; }
+
+private:
+  struct Job {
+    unsigned int texture;
+    std::string path;
+    bool flip;
+    // baked KTX2 to try first, empty when there is none
+    std::string bakedPath;
+  };
+
+  // a baked texture's levels, in place in the asset pack mapping or in
+  // bytes read for it
+  struct Baked;
+
+  // decoded pixels travelling from a worker to the GL thread
+  struct Decoded {
+    unsigned int texture;
+    std::string path;
+    unsigned char *pixels;
+    int width, height, channels;
+    Decoded *next;
+    // set instead of pixels for a baked texture
+    std::unique_ptr<Baked> compressed;
+  };
+
+  std::vector<std::thread> workers;
+  std::mutex jobMutex;
+  std::condition_variable jobReady;
+  std::deque<Job> jobs;
+  bool stopping = false;
+
+  // lock-free multi producer / single consumer stack; the GL thread takes
+  // the whole list at once and restores submission order
+  std::atomic<Decoded *> completed{nullptr};
+  std::vector<Decoded *> ready;
+
+  // uploads go through a small ring of pixel unpack buffers
+  static const unsigned int PBO_COUNT = 4;
+  unsigned int pbos[PBO_COUNT] = {};
+  unsigned int nextPbo = 0;
+
+  unsigned int pendingCount = 0;
+
+  void workerLoop();
+  void collectCompleted();
+  void upload(const Decoded &image);
+  void uploadCompressed(const Decoded &image);
+};
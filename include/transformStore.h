@@ -0,0 +1,52 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Transform components in structure of arrays layout. Setters only mark a
+// transform dirty, update() then recomputes the world matrices of dirty
+// transforms in batches of four with SSE, split across the job system when
+// there are enough of them. The world matrix is translate * rotate * scale,
+// the same matrix glm::translate followed by glm::rotate and glm::scale give.
+class TransformStore {
+public:
+  // transforms per job when the update is split
+  static const size_t PARALLEL_GRAIN = 16384;
+
+  uint32_t add(const glm::vec3 &position,
+               const glm::quat &rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+               const glm::vec3 &scale = glm::vec3(1.0f));
+  void clear();
+  size_t size() const { return positionX.size(); }
+
+  glm::vec3 position(uint32_t index) const;
+  glm::quat rotation(uint32_t index) const;
+  glm::vec3 scale(uint32_t index) const;
+
+  void setPosition(uint32_t index, const glm::vec3 &position);
+  void setRotation(uint32_t index, const glm::quat &rotation);
+  void setScale(uint32_t index, const glm::vec3 &scale);
+
+  // recompute every dirty world matrix, on the calling thread unless jobs
+  // is given. Returns how many transforms were dirty
+  size_t update(JobSystem *jobs = nullptr);
+
+  size_t dirtyCount() const { return dirtyTotal; }
+  const glm::mat4 &world(uint32_t index) const { return worlds[index]; }
+  const std::vector<glm::mat4> &worldMatrices() const { return worlds; }
+
+private:
+  std::vector<float> positionX, positionY, positionZ;
+  std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+  std::vector<float> scaleX, scaleY, scaleZ;
+  std::vector<glm::mat4> worlds;
+  std::vector<uint8_t> dirty;
+  size_t dirtyTotal = 0;
+
+  void markDirty(uint32_t index);
+  void updateRange(size_t begin, size_t end);
+};
@@ -7,6 +7,10 @@ uniform sampler2D texture2;
 // uniform float opacity;
 
 void main() {
+#ifdef DECAL
     FragColor = mix(texture(texture1, TexCoord), texture(texture2, vec2(TexCoord.x, TexCoord.y)), 0.2);
+#else
+    FragColor = texture(texture1, TexCoord);
+#endif
     // FragColor = texture(texture2, TexCoord);
 }
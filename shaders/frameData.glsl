@@ -0,0 +1,8 @@
+// written once per frame, bound at FrameUniforms::BINDING
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    float time;
+};
@@ -1,15 +1,16 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoord;
+layout(location = 2) in mat4 aInstanceModel;
 
 out vec2 TexCoord;
 uniform mat4 transform;
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat4 model; // shared by every instance, applied before aInstanceModel
+
+#include "frameData.glsl"
 
 uniform float x_offset;
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * aInstanceModel * model * vec4(aPos, 1.0);
     TexCoord = aTexCoord;
 };
@@ -0,0 +1,149 @@
+#include "allocationCounter.h"
+
+#if COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// constant initialized, so it is ready before any static constructor
+// allocates
+std::atomic<uint64_t> allocations{0};
+
+void *alignedMalloc(std::size_t size, std::size_t alignment) {
+#ifdef _WIN32
+  return _aligned_malloc(size, alignment);
+#else
+  // aligned_alloc wants a size that is a multiple of the alignment
+  size = (size + alignment - 1) & ~(alignment - 1);
+  return std::aligned_alloc(alignment, size);
+#endif
+}
+
+void alignedFree(void *memory) {
+#ifdef _WIN32
+  _aligned_free(memory);
+#else
+  std::free(memory);
+#endif
+}
+
+// null once the new handler gives up; alignment 0 takes the malloc path
+void *allocate(std::size_t size, std::size_t alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (size == 0)
+    size = 1;
+  for (;;) {
+    void *memory =
+        alignment ? alignedMalloc(size, alignment) : std::malloc(size);
+    if (memory)
+      return memory;
+    std::new_handler handler = std::get_new_handler();
+    if (!handler)
+      return nullptr;
+    handler();
+  }
+}
+
+void *allocateOrThrow(std::size_t size, std::size_t alignment) {
+  if (void *memory = allocate(size, alignment))
+    return memory;
+  throw std::bad_alloc();
+}
+
+// a new handler may throw, the nothrow forms report that as null
+void *allocateNothrow(std::size_t size, std::size_t alignment) noexcept {
+  try {
+    return allocate(size, alignment);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+} // namespace
+
+uint64_t heapAllocations() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size) { return allocateOrThrow(size, 0); }
+
+void *operator new[](std::size_t size) { return allocateOrThrow(size, 0); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateNothrow(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateNothrow(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return allocateOrThrow(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocateOrThrow(size, (std::size_t)alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return allocateNothrow(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return allocateNothrow(size, (std::size_t)alignment);
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete[](void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+
+void operator delete[](void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+  alignedFree(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept {
+  alignedFree(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+  alignedFree(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept {
+  alignedFree(memory);
+}
+
+void operator delete(void *memory, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  alignedFree(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  alignedFree(memory);
+}
+
+#else
+
+uint64_t heapAllocations() { return 0; }
+
+#endif
@@ -0,0 +1,256 @@
+#include "assetPack.h"
+#include "lz4Block.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char MAGIC[4] = {'L', 'G', 'P', 'K'};
+// an LZ4 block expands to at most about 255 times its size
+const uint64_t MAX_LZ4_RATIO = 255;
+
+bool fail(const std::string &path, const char *what) {
+  std::cout << "ERROR::ASSET_PACK::" << what << "\n" << path << std::endl;
+  return false;
+}
+
+} // namespace
+
+uint64_t hashAssetName(const std::string &name) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : name) {
+    hash ^= (uint8_t)c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+AssetPack::~AssetPack() { close(); }
+
+bool AssetPack::open(const std::string &path) {
+  close();
+
+#ifdef _WIN32
+  file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    file = nullptr;
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(file, &fileSize);
+  mappedBytes = (size_t)fileSize.QuadPart;
+  mapping = mappedBytes ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0,
+                                             NULL)
+                        : nullptr;
+  if (mapping)
+    base = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    mappedBytes = (size_t)info.st_size;
+    void *mapped = mmap(NULL, mappedBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED)
+      base = (const uint8_t *)mapped;
+  }
+  // the mapping stays valid without the descriptor
+  ::close(fd);
+#endif
+  if (!base) {
+    close();
+    return fail(path, "MAP_FAILED");
+  }
+
+  // validate the table once so lookups can trust it
+  AssetPackHeader header;
+  if (mappedBytes < sizeof(header)) {
+    close();
+    return fail(path, "NOT_A_PACK");
+  }
+  std::memcpy(&header, base, sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION ||
+      header.entriesOffset % alignof(AssetPackEntry) != 0 ||
+      header.entriesOffset > mappedBytes ||
+      (uint64_t)header.entryCount * sizeof(AssetPackEntry) >
+          mappedBytes - header.entriesOffset ||
+      header.namesOffset > mappedBytes ||
+      header.nameBytes > mappedBytes - header.namesOffset ||
+      (header.nameBytes && base[header.namesOffset + header.nameBytes - 1])) {
+    close();
+    return fail(path, "NOT_A_PACK");
+  }
+  entries = (const AssetPackEntry *)(base + header.entriesOffset);
+  names = (const char *)(base + header.namesOffset);
+  count = header.entryCount;
+  nameBytes = header.nameBytes;
+  for (uint32_t i = 0; i < count; i++) {
+    const AssetPackEntry &entry = entries[i];
+    // sizes are checked here so bytes() never allocates what the file
+    // says without bound
+    const bool lz4 = (entry.flags & FLAG_LZ4) != 0;
+    if (entry.offset > mappedBytes ||
+        entry.storedSize > mappedBytes - entry.offset ||
+        (lz4 ? entry.size < entry.storedSize ||
+                   entry.size > entry.storedSize * MAX_LZ4_RATIO
+             : entry.size != entry.storedSize) ||
+        entry.nameOffset >= nameBytes ||
+        (i > 0 && entries[i - 1].hash > entry.hash)) {
+      close();
+      return fail(path, "CORRUPT_TABLE");
+    }
+  }
+  return true;
+}
+
+void AssetPack::close() {
+#ifdef _WIN32
+  if (base)
+    UnmapViewOfFile(base);
+  if (mapping)
+    CloseHandle(mapping);
+  if (file)
+    CloseHandle(file);
+  mapping = nullptr;
+  file = nullptr;
+#else
+  if (base)
+    munmap((void *)base, mappedBytes);
+#endif
+  base = nullptr;
+  mappedBytes = 0;
+  entries = nullptr;
+  names = nullptr;
+  count = 0;
+  nameBytes = 0;
+}
+
+const AssetPackEntry *AssetPack::find(const std::string &name) const {
+  if (!base)
+    return nullptr;
+  uint64_t hash = hashAssetName(name);
+  const AssetPackEntry *entry = std::lower_bound(
+      entries, entries + count, hash,
+      [](const AssetPackEntry &e, uint64_t h) { return e.hash < h; });
+  // colliding hashes sit next to each other, the names tell them apart
+  for (; entry != entries + count && entry->hash == hash; entry++)
+    if (name == names + entry->nameOffset)
+      return entry;
+  return nullptr;
+}
+
+bool AssetPack::contains(const std::string &name) const {
+  return find(name) != nullptr;
+}
+
+const uint8_t *AssetPack::bytes(const std::string &name,
+                                std::vector<uint8_t> &scratch,
+                                size_t &size) const {
+  const AssetPackEntry *entry = find(name);
+  if (!entry)
+    return nullptr;
+
+  const uint8_t *stored = base + entry->offset;
+  size = (size_t)entry->size;
+  if (!(entry->flags & FLAG_LZ4))
+    return stored;
+
+  scratch.resize(size);
+  if (!lz4Decompress(stored, (size_t)entry->storedSize, scratch.data(),
+                     size)) {
+    fail(name, "CORRUPT_ENTRY");
+    return nullptr;
+  }
+  return scratch.data();
+}
+
+AssetPack &assetPack() {
+  static AssetPack pack;
+  return pack;
+}
+
+bool writeAssetPack(const std::string &path,
+                    const std::vector<AssetPackInput> &inputs, bool lz4) {
+  std::vector<size_t> order(inputs.size());
+  std::vector<uint64_t> hashes(inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    order[i] = i;
+    hashes[i] = hashAssetName(inputs[i].name);
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return hashes[a] != hashes[b] ? hashes[a] < hashes[b]
+                                  : inputs[a].name < inputs[b].name;
+  });
+  for (size_t i = 1; i < order.size(); i++)
+    if (inputs[order[i]].name == inputs[order[i - 1]].name)
+      return fail(inputs[order[i]].name, "DUPLICATE_NAME");
+
+  std::vector<char> nameTable;
+  std::vector<AssetPackEntry> table(inputs.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    const AssetPackInput &input = inputs[order[i]];
+    table[i].hash = hashes[order[i]];
+    table[i].size = input.bytes.size();
+    table[i].nameOffset = (uint32_t)nameTable.size();
+    table[i].flags = 0;
+    nameTable.insert(nameTable.end(), input.name.begin(), input.name.end());
+    nameTable.push_back('\0');
+  }
+
+  AssetPackHeader header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = AssetPack::VERSION;
+  header.entryCount = (uint32_t)table.size();
+  header.nameBytes = (uint32_t)nameTable.size();
+  header.entriesOffset = sizeof(AssetPackHeader);
+  header.namesOffset =
+      header.entriesOffset + table.size() * sizeof(AssetPackEntry);
+
+  std::vector<uint8_t> blobs;
+  const uint64_t blobStart = header.namesOffset + nameTable.size();
+  std::vector<uint8_t> compressed;
+  for (size_t i = 0; i < order.size(); i++) {
+    const std::vector<uint8_t> &bytes = inputs[order[i]].bytes;
+    while ((blobStart + blobs.size()) % AssetPack::ALIGNMENT)
+      blobs.push_back(0);
+    table[i].offset = blobStart + blobs.size();
+
+    compressed.clear();
+    if (lz4 && inputs[order[i]].compress && !bytes.empty())
+      lz4Compress(bytes.data(), bytes.size(), compressed);
+    if (!compressed.empty() &&
+        compressed.size() <= bytes.size() - bytes.size() / 8) {
+      table[i].flags |= AssetPack::FLAG_LZ4;
+      table[i].storedSize = compressed.size();
+      blobs.insert(blobs.end(), compressed.begin(), compressed.end());
+    } else {
+      table[i].storedSize = bytes.size();
+      blobs.insert(blobs.end(), bytes.begin(), bytes.end());
+    }
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char *)&header, sizeof(header));
+  file.write((const char *)table.data(),
+             (std::streamsize)(table.size() * sizeof(AssetPackEntry)));
+  file.write(nameTable.data(), (std::streamsize)nameTable.size());
+  file.write((const char *)blobs.data(), (std::streamsize)blobs.size());
+  return file ? true : fail(path, "WRITE_FAILED");
+}
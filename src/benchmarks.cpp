@@ -0,0 +1,479 @@
+#include "benchmarks.h"
+#include "allocationCounter.h"
+#include "bvh.h"
+#include "frameArena.h"
+#include "frustumCulling.h"
+#include "jobSystem.h"
+#include "meshBuilder.h"
+#include "renderQueue.h"
+#include "transformStore.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// draws spread over a handful of programs, texture sets and meshes in
+// random order, the way an unsorted scene submits them
+int benchRenderQueue(unsigned int count) {
+  if (count == 0)
+    count = 10000;
+  const unsigned int programs = 8, textureSets = 32, vaos = 16;
+  const int iterations = 100;
+
+  struct Draw {
+    unsigned int program, textureSet, vao;
+    float depth;
+  };
+  std::mt19937 rng(1234);
+  std::vector<Draw> draws(count);
+  for (Draw &draw : draws) {
+    draw.program = rng() % programs;
+    draw.textureSet = rng() % textureSets;
+    draw.vao = rng() % vaos;
+    draw.depth = std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+  }
+
+  RenderQueue queue;
+  auto submitAll = [&] {
+    queue.clear();
+    for (const Draw &draw : draws)
+      queue.submit(0, draw.program, draw.textureSet, draw.vao, draw.depth,
+                   GL_TRIANGLES, 0, 36);
+  };
+
+  submitAll();
+  RenderQueue::ExecuteStats before = queue.simulate();
+  queue.sort();
+  RenderQueue::ExecuteStats after = queue.simulate();
+
+  double radixMs = 0.0;
+  for (int i = 0; i < iterations; i++) {
+    submitAll();
+    Clock::time_point start = Clock::now();
+    queue.sort();
+    radixMs += elapsedMs(start);
+  }
+
+  std::vector<uint64_t> keys(count);
+  double stdSortMs = 0.0;
+  for (int i = 0; i < iterations; i++) {
+    for (unsigned int j = 0; j < count; j++)
+      keys[j] = RenderQueue::makeKey(0, draws[j].program, draws[j].textureSet,
+                                     draws[j].vao, draws[j].depth);
+    Clock::time_point start = Clock::now();
+    std::sort(keys.begin(), keys.end());
+    stdSortMs += elapsedMs(start);
+  }
+
+  auto printStats = [](const char *label,
+                       const RenderQueue::ExecuteStats &stats) {
+    std::cout << "  " << label << ": " << stats.stateChanges()
+              << " state changes per frame (program " << stats.programChanges
+              << ", textures " << stats.textureChanges << ", vao "
+              << stats.vaoChanges << ")\n";
+  };
+
+  std::cout << "render queue, " << count << " draws, " << programs
+            << " programs, " << textureSets << " texture sets, " << vaos
+            << " meshes\n";
+  printStats("submission order", before);
+  printStats("sorted", after);
+  std::cout << "  radix sort " << radixMs / iterations << " ms, std::sort "
+            << stdSortMs / iterations << " ms (keys only)" << std::endl;
+  return 0;
+}
+
+// spheres scattered around the default camera, culled by every path
+int benchFrustumCulling(unsigned int count) {
+  if (count == 0)
+    count = 100000;
+  const int iterations = 100;
+
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> spread(-100.0f, 100.0f);
+  SphereSet spheres;
+  AabbSet boxes;
+  for (unsigned int i = 0; i < count; i++) {
+    glm::vec3 center(spread(rng), spread(rng), spread(rng));
+    spheres.add(center, 0.8660254f);
+    boxes.add(center - glm::vec3(0.5f), center + glm::vec3(0.5f));
+  }
+
+  glm::mat4 projection =
+      glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
+                               glm::vec3(0.0f, 0.0f, 2.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  Frustum frustum = extractFrustum(projection * view);
+
+  std::cout << "frustum culling, " << count << " objects\n";
+  std::vector<uint32_t> visible;
+  visible.reserve(count);
+  for (CullPath path : {CullPath::Scalar, CullPath::Sse2, CullPath::Avx2}) {
+    if (!cullPathSupported(path))
+      continue;
+
+    double sphereMs = 0.0, boxMs = 0.0;
+    size_t sphereVisible = 0, boxVisible = 0;
+    for (int i = 0; i < iterations; i++) {
+      Clock::time_point start = Clock::now();
+      sphereVisible = cullSpheres(frustum, spheres, visible, path);
+      sphereMs += elapsedMs(start);
+
+      start = Clock::now();
+      boxVisible = cullAabbs(frustum, boxes, visible, path);
+      boxMs += elapsedMs(start);
+    }
+    std::cout << "  " << cullPathName(path) << ": spheres "
+              << sphereMs / iterations << " ms (" << sphereVisible
+              << " visible), boxes " << boxMs / iterations << " ms ("
+              << boxVisible << " visible)\n";
+  }
+  std::cout << std::flush;
+  return 0;
+}
+
+// flat culling against the BVH as the scene grows but the view does not
+int benchBvh(unsigned int count) {
+  if (count == 0)
+    count = 100000;
+  const int iterations = 100;
+
+  glm::mat4 projection =
+      glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
+                               glm::vec3(0.0f, 0.0f, 2.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  Frustum frustum = extractFrustum(projection * view);
+
+  std::cout << "bvh vs flat culling\n";
+  for (unsigned int scale = 1; scale <= 16; scale *= 4) {
+    unsigned int objects = count * scale;
+    // the volume grows with the count so visible objects stay constant
+    float half = 100.0f * std::cbrt((float)scale);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> spread(-half, half);
+
+    AabbSet boxes;
+    std::vector<glm::vec3> mins(objects), maxs(objects);
+    for (unsigned int i = 0; i < objects; i++) {
+      glm::vec3 center(spread(rng), spread(rng), spread(rng));
+      mins[i] = center - glm::vec3(0.8660254f);
+      maxs[i] = center + glm::vec3(0.8660254f);
+      boxes.add(mins[i], maxs[i]);
+    }
+
+    Clock::time_point start = Clock::now();
+    Bvh bvh;
+    bvh.build(mins, maxs);
+    double buildMs = elapsedMs(start);
+
+    std::vector<uint32_t> visible;
+    visible.reserve(objects);
+    double flatMs = 0.0, bvhMs = 0.0;
+    Bvh::CullStats stats;
+    for (int i = 0; i < iterations; i++) {
+      start = Clock::now();
+      cullAabbs(frustum, boxes, visible);
+      flatMs += elapsedMs(start);
+
+      visible.clear();
+      start = Clock::now();
+      stats = bvh.cull(frustum, visible);
+      bvhMs += elapsedMs(start);
+    }
+
+    std::cout << "  " << objects << " objects, " << visible.size()
+              << " visible: flat " << flatMs / iterations << " ms, bvh "
+              << bvhMs / iterations << " ms (" << stats.nodesVisited
+              << " of " << bvh.nodeCount() << " nodes), build " << buildMs
+              << " ms\n";
+  }
+  std::cout << std::flush;
+  return 0;
+}
+
+// every cube spinning on its own, the way the original loop rebuilt each
+// model matrix with glm::translate and glm::rotate
+int benchTransforms(unsigned int count) {
+  if (count == 0)
+    count = 1000000;
+  const int iterations = 20;
+  const glm::vec3 axis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> spread(-100.0f, 100.0f);
+  std::vector<glm::vec3> positions(count);
+  for (glm::vec3 &position : positions)
+    position = glm::vec3(spread(rng), spread(rng), spread(rng));
+
+  TransformStore store;
+  for (const glm::vec3 &position : positions)
+    store.add(position);
+  JobSystem jobs;
+
+  std::vector<glm::mat4> reference(count);
+  double glmMs = 0.0, serialMs = 0.0, parallelMs = 0.0, sparseMs = 0.0;
+  for (int i = 0; i < iterations; i++) {
+    float angle = 0.01f * (i + 1) + 0.0001f;
+
+    Clock::time_point start = Clock::now();
+    for (unsigned int j = 0; j < count; j++)
+      reference[j] = glm::rotate(glm::translate(glm::mat4(1.0f), positions[j]),
+                                 angle, axis);
+    glmMs += elapsedMs(start);
+
+    glm::quat spin = glm::angleAxis(angle, axis);
+    for (unsigned int j = 0; j < count; j++)
+      store.setRotation(j, spin);
+    start = Clock::now();
+    store.update();
+    serialMs += elapsedMs(start);
+
+    for (unsigned int j = 0; j < count; j++)
+      store.setRotation(j, spin);
+    start = Clock::now();
+    store.update(&jobs);
+    parallelMs += elapsedMs(start);
+
+    // one transform in a hundred moves, the rest are skipped
+    for (unsigned int j = 0; j < count; j += 100)
+      store.setRotation(j, spin);
+    start = Clock::now();
+    store.update(&jobs);
+    sparseMs += elapsedMs(start);
+  }
+
+  float maxError = 0.0f;
+  for (unsigned int j = 0; j < count; j++)
+    for (int column = 0; column < 4; column++)
+      for (int row = 0; row < 4; row++)
+        maxError = std::max(maxError, std::fabs(store.world(j)[column][row] -
+                                                reference[j][column][row]));
+
+  std::cout << count << " transforms, " << jobs.threadCount()
+            << " job threads\n"
+            << "  glm translate * rotate: " << glmMs / iterations << " ms\n"
+            << "  store, one thread:      " << serialMs / iterations << " ms\n"
+            << "  store, job system:      " << parallelMs / iterations
+            << " ms\n"
+            << "  store, 1% dirty:        " << sparseMs / iterations << " ms\n"
+            << "  max difference to glm:  " << maxError << std::endl;
+  return 0;
+}
+
+// busy work the compiler cannot drop, scaled to a duration by calibrate()
+volatile float workSink;
+
+void spin(unsigned int iterations) {
+  float x = 1.0f;
+  for (unsigned int i = 0; i < iterations; i++)
+    x = x * 1.0000001f + 0.0000001f;
+  workSink = x;
+}
+
+unsigned int spinIterationsPerUs() {
+  const unsigned int iterations = 10000000;
+  Clock::time_point start = Clock::now();
+  spin(iterations);
+  return (unsigned int)(iterations / (elapsedMs(start) * 1000.0));
+}
+
+// the same total work cut into tasks of 1 us to 1 ms, run serially, one
+// std::async per task, as job system jobs and through parallelFor
+int benchJobs(unsigned int count) {
+  if (count == 0)
+    count = 20000;
+  const unsigned int perUs = spinIterationsPerUs();
+  const unsigned int taskSizes[] = {1, 10, 100, 1000};
+
+  JobSystem jobs;
+  std::cout << "jobs, " << count << " us of work per run, "
+            << jobs.threadCount() << " job threads\n";
+  for (unsigned int taskUs : taskSizes) {
+    unsigned int tasks = std::max(1u, count / taskUs);
+    unsigned int iterations = taskUs * perUs;
+
+    Clock::time_point start = Clock::now();
+    for (unsigned int i = 0; i < tasks; i++)
+      spin(iterations);
+    double serialMs = elapsedMs(start);
+
+    start = Clock::now();
+    std::vector<std::future<void>> futures;
+    futures.reserve(tasks);
+    for (unsigned int i = 0; i < tasks; i++)
+      futures.push_back(
+          std::async(std::launch::async, [iterations] { spin(iterations); }));
+    for (std::future<void> &future : futures)
+      future.get();
+    double asyncMs = elapsedMs(start);
+
+    start = Clock::now();
+    JobSystem::Counter counter;
+    for (unsigned int i = 0; i < tasks; i++)
+      jobs.run([iterations] { spin(iterations); }, &counter);
+    jobs.wait(counter);
+    double jobMs = elapsedMs(start);
+
+    start = Clock::now();
+    jobs.parallelFor(0, tasks, 1, [iterations](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++)
+        spin(iterations);
+    });
+    double forMs = elapsedMs(start);
+
+    std::cout << "  " << tasks << " x " << taskUs << " us: serial "
+              << serialMs << " ms, std::async " << asyncMs << " ms, jobs "
+              << jobMs << " ms, parallelFor " << forMs << " ms\n";
+  }
+  std::cout << std::flush;
+  return 0;
+}
+
+// transient lists built every frame, grown one element at a time the way
+// visible lists and staging data are, from the heap and from the arena
+int benchFrameArena(unsigned int count) {
+  if (count == 0)
+    count = 100;
+  const int frames = 200;
+  const unsigned int elements = 1000;
+
+  auto buildLists = [&](auto makeList) {
+    for (unsigned int list = 0; list < count; list++) {
+      auto values = makeList();
+      for (unsigned int i = 0; i < elements; i++)
+        values.push_back(list * i);
+      workSink = (float)values.back();
+    }
+  };
+
+  Clock::time_point start = Clock::now();
+  uint64_t allocations = heapAllocations();
+  for (int frame = 0; frame < frames; frame++)
+    buildLists([] { return std::vector<uint32_t>(); });
+  double heapMs = elapsedMs(start);
+  uint64_t heapAllocs = heapAllocations() - allocations;
+
+  FrameArena arena;
+  start = Clock::now();
+  allocations = heapAllocations();
+  for (int frame = 0; frame < frames; frame++) {
+    buildLists(
+        [&] { return FrameVector<uint32_t>(FrameAllocator<uint32_t>(arena)); });
+    arena.nextFrame();
+  }
+  double arenaMs = elapsedMs(start);
+  uint64_t arenaAllocs = heapAllocations() - allocations;
+
+  if (!COUNT_ALLOCATIONS)
+    std::cout << "heap allocations are only counted with "
+                 "-DCOUNT_ALLOCATIONS=ON\n";
+  std::cout << count << " lists of " << elements << " per frame\n"
+            << "  std::vector: " << heapMs / frames << " ms, "
+            << (double)heapAllocs / frames << " heap allocations per frame\n"
+            << "  FrameVector: " << arenaMs / frames << " ms, "
+            << (double)arenaAllocs / frames
+            << " heap allocations per frame, peak "
+            << arena.peakFrameBytes() << " bytes, "
+            << arena.overflowCount() << " overflows" << std::endl;
+  return 0;
+}
+
+// a count x count grid of quads as an expanded triangle list with its
+// triangles shuffled, the worst order the vertex cache can be handed
+int benchMeshBuilder(unsigned int count) {
+  if (count == 0)
+    count = 100;
+  const unsigned int vertexFloats = 3;
+
+  std::vector<std::array<float, 9>> triangles;
+  triangles.reserve((size_t)count * count * 2);
+  for (unsigned int y = 0; y < count; y++)
+    for (unsigned int x = 0; x < count; x++) {
+      float x0 = (float)x, x1 = (float)(x + 1);
+      float y0 = (float)y, y1 = (float)(y + 1);
+      triangles.push_back({x0, y0, 0.0f, x1, y0, 0.0f, x1, y1, 0.0f});
+      triangles.push_back({x0, y0, 0.0f, x1, y1, 0.0f, x0, y1, 0.0f});
+    }
+  std::mt19937 rng(42);
+  std::shuffle(triangles.begin(), triangles.end(), rng);
+
+  std::vector<float> vertices;
+  vertices.reserve(triangles.size() * 9);
+  for (const std::array<float, 9> &triangle : triangles)
+    vertices.insert(vertices.end(), triangle.begin(), triangle.end());
+
+  MeshBuildStats stats;
+  Clock::time_point start = Clock::now();
+  IndexedMesh mesh = buildIndexedMesh(vertices, vertexFloats, &stats);
+  double buildMs = elapsedMs(start);
+
+  std::cout << count << "x" << count << " grid, " << triangles.size()
+            << " shuffled triangles\n"
+            << "  " << stats.inputVertices << " vertices welded to "
+            << stats.outputVertices << " in " << buildMs << " ms\n"
+            << "  ACMR (" << ACMR_CACHE_SIZE << " entry FIFO) "
+            << stats.acmrBefore << " before, " << stats.acmrAfter
+            << " after, " << mesh.indices.size() / 3 << " triangles"
+            << std::endl;
+  return 0;
+}
+
+struct Benchmark {
+  const char *name;
+  int (*run)(unsigned int count);
+  const char *description;
+};
+
+const Benchmark BENCHMARKS[] = {
+    {"queue", benchRenderQueue,
+     "state changes and sort time of the render queue"},
+    {"cull", benchFrustumCulling,
+     "frustum culling time per SIMD path for spheres and boxes"},
+    {"bvh", benchBvh, "bvh against flat culling as the scene grows"},
+    {"transforms", benchTransforms,
+     "world matrix update of the transform store against glm"},
+    {"jobs", benchJobs,
+     "job system against std::async and serial code per task size"},
+    {"arena", benchFrameArena,
+     "per frame lists from the heap against the frame arena"},
+    {"mesh", benchMeshBuilder,
+     "vertex cache ACMR of a shuffled grid before and after reordering"},
+};
+
+} // namespace
+
+int runBenchmark(const char *name, unsigned int count) {
+  for (const Benchmark &benchmark : BENCHMARKS)
+    if (std::strcmp(benchmark.name, name) == 0)
+      return benchmark.run(count);
+
+  std::cerr << "Unknown benchmark " << name << std::endl;
+  listBenchmarks();
+  return -1;
+}
+
+void listBenchmarks() {
+  std::cout << "Benchmarks:\n";
+  for (const Benchmark &benchmark : BENCHMARKS)
+    std::cout << "  " << benchmark.name << "  " << benchmark.description
+              << "\n";
+  std::cout << std::flush;
+}
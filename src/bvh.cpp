@@ -0,0 +1,306 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+const int SAH_BINS = 16;
+
+// below this depth splits are forced to the median, which bounds the tree
+// depth and with it the traversal stacks
+const unsigned int MAX_SAH_DEPTH = 64;
+const int STACK_SIZE = 128;
+
+struct Bounds {
+  glm::vec3 min = glm::vec3(FLT_MAX);
+  glm::vec3 max = glm::vec3(-FLT_MAX);
+
+  void grow(const glm::vec3 &point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+  void grow(const Bounds &other) {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+  }
+  float area() const {
+    glm::vec3 size = max - min;
+    if (size.x < 0.0f)
+      return 0.0f;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  }
+};
+
+// 1 when fully inside the plane, -1 when fully outside, 0 when crossing
+int classify(const glm::vec4 &plane, const glm::vec3 &min,
+             const glm::vec3 &max) {
+  glm::vec3 center = (min + max) * 0.5f;
+  glm::vec3 extent = (max - min) * 0.5f;
+  float distance =
+      plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+  float reach = std::fabs(plane.x) * extent.x +
+                std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+  if (distance < -reach)
+    return -1;
+  if (distance >= reach)
+    return 1;
+  return 0;
+}
+
+// slab test, returns the entry distance or FLT_MAX on a miss
+float intersect(const glm::vec3 &origin, const glm::vec3 &inverse,
+                const glm::vec3 &min, const glm::vec3 &max, float limit) {
+  float near = 0.0f, far = limit;
+  for (int axis = 0; axis < 3; axis++) {
+    float t0 = (min[axis] - origin[axis]) * inverse[axis];
+    float t1 = (max[axis] - origin[axis]) * inverse[axis];
+    if (t0 > t1)
+      std::swap(t0, t1);
+    near = std::max(near, t0);
+    far = std::min(far, t1);
+    if (near > far)
+      return FLT_MAX;
+  }
+  return near;
+}
+
+} // namespace
+
+void Bvh::build(const std::vector<glm::vec3> &mins,
+                const std::vector<glm::vec3> &maxs) {
+  objectMin = mins;
+  objectMax = maxs;
+  nodes.clear();
+  objectOrder.resize(mins.size());
+  if (mins.empty())
+    return;
+
+  std::vector<glm::vec3> centroids(mins.size());
+  for (uint32_t i = 0; i < mins.size(); i++) {
+    objectOrder[i] = i;
+    centroids[i] = (mins[i] + maxs[i]) * 0.5f;
+  }
+
+  nodes.reserve(mins.size() * 2 / MAX_LEAF_OBJECTS + 1);
+  buildNode(0, (uint32_t)mins.size(), centroids, 0);
+}
+
+void Bvh::buildNode(uint32_t first, uint32_t count,
+                    std::vector<glm::vec3> &centroids, unsigned int depth) {
+  uint32_t index = (uint32_t)nodes.size();
+  nodes.push_back(Node());
+
+  Bounds bounds, centroidBounds;
+  for (uint32_t i = first; i < first + count; i++) {
+    uint32_t object = objectOrder[i];
+    bounds.grow(objectMin[object]);
+    bounds.grow(objectMax[object]);
+    centroidBounds.grow(centroids[object]);
+  }
+  nodes[index].min = bounds.min;
+  nodes[index].max = bounds.max;
+  nodes[index].first = first;
+
+  // find the cheapest binned split over all three axes
+  int bestAxis = -1;
+  int bestSplit = 0;
+  float bestCost = FLT_MAX;
+  if (count > MAX_LEAF_OBJECTS && depth < MAX_SAH_DEPTH) {
+    for (int axis = 0; axis < 3; axis++) {
+      float low = centroidBounds.min[axis];
+      float extent = centroidBounds.max[axis] - low;
+      if (extent <= 0.0f)
+        continue;
+
+      Bounds binBounds[SAH_BINS];
+      uint32_t binCounts[SAH_BINS] = {};
+      float scale = SAH_BINS / extent;
+      for (uint32_t i = first; i < first + count; i++) {
+        uint32_t object = objectOrder[i];
+        int bin = std::min(
+            SAH_BINS - 1, (int)((centroids[object][axis] - low) * scale));
+        binCounts[bin]++;
+        binBounds[bin].grow(objectMin[object]);
+        binBounds[bin].grow(objectMax[object]);
+      }
+
+      // sweep from the right, then from the left
+      float rightArea[SAH_BINS];
+      uint32_t rightCount[SAH_BINS];
+      Bounds right;
+      uint32_t rightTotal = 0;
+      for (int bin = SAH_BINS - 1; bin > 0; bin--) {
+        right.grow(binBounds[bin]);
+        rightTotal += binCounts[bin];
+        rightArea[bin] = right.area();
+        rightCount[bin] = rightTotal;
+      }
+      Bounds left;
+      uint32_t leftTotal = 0;
+      for (int split = 1; split < SAH_BINS; split++) {
+        left.grow(binBounds[split - 1]);
+        leftTotal += binCounts[split - 1];
+        if (leftTotal == 0 || rightCount[split] == 0)
+          continue;
+        float cost = leftTotal * left.area() +
+                     rightCount[split] * rightArea[split];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestSplit = split;
+        }
+      }
+    }
+  }
+
+  uint32_t middle = first;
+  if (bestAxis >= 0) {
+    float low = centroidBounds.min[bestAxis];
+    float scale = SAH_BINS / (centroidBounds.max[bestAxis] - low);
+    auto leftOfSplit = [&](uint32_t object) {
+      float offset = centroids[object][bestAxis] - low;
+      return std::min(SAH_BINS - 1, (int)(offset * scale)) < bestSplit;
+    };
+    uint32_t *begin = objectOrder.data() + first;
+    middle = (uint32_t)(std::partition(begin, begin + count, leftOfSplit) -
+                        objectOrder.data());
+  } else if (depth >= MAX_SAH_DEPTH && count > MAX_LEAF_OBJECTS) {
+    // median on the widest axis halves the range every level
+    glm::vec3 size = centroidBounds.max - centroidBounds.min;
+    int axis = size.x > size.y ? (size.x > size.z ? 0 : 2)
+                               : (size.y > size.z ? 1 : 2);
+    uint32_t *begin = objectOrder.data() + first;
+    std::nth_element(begin, begin + count / 2, begin + count,
+                     [&](uint32_t a, uint32_t b) {
+                       return centroids[a][axis] < centroids[b][axis];
+                     });
+    middle = first + count / 2;
+  } else if (count > MAX_LEAF_OBJECTS * 4) {
+    // all centroids coincide, split in the middle so leaves stay small
+    middle = first + count / 2;
+  }
+
+  if (middle > first && middle < first + count) {
+    buildNode(first, middle - first, centroids, depth + 1);
+    buildNode(middle, first + count - middle, centroids, depth + 1);
+  }
+  nodes[index].skip = (uint32_t)nodes.size();
+}
+
+Bvh::CullStats Bvh::cull(const Frustum &frustum,
+                         std::vector<uint32_t> &visible) const {
+  CullStats stats;
+  if (nodes.empty())
+    return stats;
+
+  // bit i set means plane i still has to be tested below this node
+  struct Entry {
+    uint32_t node;
+    uint32_t planes;
+  };
+  Entry stack[STACK_SIZE];
+  int top = 0;
+  stack[top++] = Entry{0, 0x3f};
+
+  while (top > 0) {
+    Entry entry = stack[--top];
+    const Node &node = nodes[entry.node];
+    stats.nodesVisited++;
+
+    uint32_t planes = entry.planes;
+    bool outside = false;
+    for (int plane = 0; plane < 6 && !outside; plane++) {
+      if (!(planes & (1u << plane)))
+        continue;
+      int side = classify(frustum.planes[plane], node.min, node.max);
+      if (side < 0)
+        outside = true;
+      else if (side > 0)
+        planes &= ~(1u << plane);
+    }
+    if (outside)
+      continue;
+
+    uint32_t end = rangeEnd(entry.node);
+    bool leaf = node.skip == entry.node + 1;
+    if (planes == 0) {
+      // fully inside, take the whole subtree without looking further
+      visible.insert(visible.end(), objectOrder.begin() + node.first,
+                     objectOrder.begin() + end);
+    } else if (leaf) {
+      for (uint32_t i = node.first; i < end; i++) {
+        uint32_t object = objectOrder[i];
+        stats.objectsTested++;
+        bool inside = true;
+        for (int plane = 0; plane < 6 && inside; plane++)
+          if ((planes & (1u << plane)) &&
+              classify(frustum.planes[plane], objectMin[object],
+                       objectMax[object]) < 0)
+            inside = false;
+        if (inside)
+          visible.push_back(object);
+      }
+    } else {
+      uint32_t left = entry.node + 1;
+      stack[top++] = Entry{nodes[left].skip, planes};
+      stack[top++] = Entry{left, planes};
+    }
+  }
+  return stats;
+}
+
+int Bvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                 float &distance) const {
+  if (nodes.empty())
+    return -1;
+
+  glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y,
+                    1.0f / direction.z);
+  int hit = -1;
+  float nearest = FLT_MAX;
+
+  uint32_t stack[STACK_SIZE];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    uint32_t index = stack[--top];
+    const Node &node = nodes[index];
+    if (intersect(origin, inverse, node.min, node.max, nearest) == FLT_MAX)
+      continue;
+
+    if (node.skip == index + 1) {
+      for (uint32_t i = node.first; i < rangeEnd(index); i++) {
+        uint32_t object = objectOrder[i];
+        float t = intersect(origin, inverse, objectMin[object],
+                            objectMax[object], nearest);
+        if (t < nearest) {
+          nearest = t;
+          hit = (int)object;
+        }
+      }
+      continue;
+    }
+
+    // visit the nearer child first so farther boxes are rejected early
+    uint32_t left = index + 1;
+    uint32_t right = nodes[left].skip;
+    float leftT = intersect(origin, inverse, nodes[left].min, nodes[left].max,
+                            nearest);
+    float rightT = intersect(origin, inverse, nodes[right].min,
+                             nodes[right].max, nearest);
+    if (leftT > rightT) {
+      std::swap(left, right);
+      std::swap(leftT, rightT);
+    }
+    if (rightT != FLT_MAX)
+      stack[top++] = right;
+    if (leftT != FLT_MAX)
+      stack[top++] = left;
+  }
+
+  distance = nearest;
+  return hit;
+}
@@ -0,0 +1,255 @@
+#include "errorReporting.h"
+
+#if GL_ERROR_REPORTING
+
+#include "glExtensions.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// at most this many driver messages are logged per second
+const int RATE_LIMIT_PER_SECOND = 50;
+
+// a message id repeating more often than this is only counted
+const uint32_t MAX_REPEATS = 3;
+
+// every field that tells two driver messages apart, each kept whole
+struct MessageKey {
+  GLenum source;
+  GLenum type;
+  GLenum severity;
+  unsigned int id;
+
+  bool operator==(const MessageKey &other) const {
+    return source == other.source && type == other.type &&
+           severity == other.severity && id == other.id;
+  }
+};
+
+struct MessageKeyHash {
+  size_t operator()(const MessageKey &key) const {
+    uint64_t hash = ((uint64_t)key.id << 32) | key.source;
+    hash = hash * 1099511628211ull ^ (((uint64_t)key.type << 32) |
+                                      key.severity);
+    return (size_t)(hash ^ (hash >> 29));
+  }
+};
+
+struct ErrorLog {
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::string pending;
+  std::ofstream file;
+  std::thread writer;
+  bool running = false;
+
+  // deduplication and rate limiting, also guarded by mutex since the
+  // driver may call back from its own thread in asynchronous mode
+  std::unordered_map<MessageKey, uint32_t, MessageKeyHash> seen;
+  std::chrono::steady_clock::time_point windowStart;
+  int windowCount = 0;
+  uint64_t duplicates = 0;
+  uint64_t rateLimited = 0;
+};
+
+ErrorLog &errorLog() {
+  static ErrorLog log;
+  return log;
+}
+
+void writerLoop() {
+  ErrorLog &log = errorLog();
+  std::string batch;
+
+  std::unique_lock<std::mutex> lock(log.mutex);
+  while (log.running || !log.pending.empty()) {
+    log.wake.wait(lock,
+                  [&log] { return !log.running || !log.pending.empty(); });
+    batch.swap(log.pending);
+
+    lock.unlock();
+    log.file << batch;
+    log.file.flush();
+    batch.clear();
+    lock.lock();
+  }
+}
+
+// caller holds the mutex
+void queueLine(ErrorLog &log, const std::string &line) {
+  if (log.running) {
+    log.pending += line;
+    log.pending += '\n';
+    log.wake.notify_one();
+  } else {
+    std::cerr << line << std::endl;
+  }
+}
+
+const char *sourceName(GLenum source) {
+  switch (source) {
+  case GL_DEBUG_SOURCE_API:
+    return "API";
+  case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+    return "Window System";
+  case GL_DEBUG_SOURCE_SHADER_COMPILER:
+    return "Shader Compiler";
+  case GL_DEBUG_SOURCE_THIRD_PARTY:
+    return "Third Party";
+  case GL_DEBUG_SOURCE_APPLICATION:
+    return "Application";
+  default:
+    return "Other";
+  }
+}
+
+const char *typeName(GLenum type) {
+  switch (type) {
+  case GL_DEBUG_TYPE_ERROR:
+    return "Error";
+  case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+    return "Deprecated Behaviour";
+  case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+    return "Undefined Behaviour";
+  case GL_DEBUG_TYPE_PORTABILITY:
+    return "Portability";
+  case GL_DEBUG_TYPE_PERFORMANCE:
+    return "Performance";
+  case GL_DEBUG_TYPE_MARKER:
+    return "Marker";
+  case GL_DEBUG_TYPE_PUSH_GROUP:
+    return "Push Group";
+  case GL_DEBUG_TYPE_POP_GROUP:
+    return "Pop Group";
+  default:
+    return "Other";
+  }
+}
+
+const char *severityName(GLenum severity) {
+  switch (severity) {
+  case GL_DEBUG_SEVERITY_HIGH:
+    return "high";
+  case GL_DEBUG_SEVERITY_MEDIUM:
+    return "medium";
+  case GL_DEBUG_SEVERITY_LOW:
+    return "low";
+  default:
+    return "notification";
+  }
+}
+
+} // namespace
+
+void GLAPIENTRY glDebugOutput(GLenum source, GLenum type, unsigned int id,
+                              GLenum severity, GLsizei length,
+                              const char *message, const void *userParam) {
+  ErrorLog &log = errorLog();
+  MessageKey key{source, type, severity, id};
+
+  std::lock_guard<std::mutex> lock(log.mutex);
+
+  uint32_t &repeats = log.seen[key];
+  if (++repeats > MAX_REPEATS) {
+    log.duplicates++;
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (now - log.windowStart >= std::chrono::seconds(1)) {
+    log.windowStart = now;
+    log.windowCount = 0;
+  }
+  if (++log.windowCount > RATE_LIMIT_PER_SECOND) {
+    log.rateLimited++;
+    return;
+  }
+
+  std::string line = "GL [";
+  line += severityName(severity);
+  line += "] ";
+  line += sourceName(source);
+  line += " / ";
+  line += typeName(type);
+  line += " (" + std::to_string(id) + "): ";
+  if (length >= 0)
+    line.append(message, length);
+  else
+    line += message;
+  if (repeats == MAX_REPEATS)
+    line += " [further repeats suppressed]";
+
+  queueLine(log, line);
+}
+
+void enableReportGlErrors(bool synchronous) {
+  GLint flags = 0;
+  glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+  if (!GLEXT_KHR_debug || !(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
+    reportError("GL debug output unavailable, not a KHR_debug debug context");
+    return;
+  }
+
+  glEnable(GL_DEBUG_OUTPUT);
+  if (synchronous)
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  else
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+  glDebugMessageCallback(glDebugOutput, nullptr);
+  // everything but notifications, which some drivers emit per buffer upload
+  glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr,
+                        GL_TRUE);
+  glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE,
+                        GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+}
+
+void createErrorFile(const char *path) {
+  ErrorLog &log = errorLog();
+  std::lock_guard<std::mutex> lock(log.mutex);
+  if (log.running)
+    return;
+
+  log.file.open(path, std::ios::out | std::ios::trunc);
+  if (!log.file) {
+    std::cerr << "Failed to open " << path << std::endl;
+    return;
+  }
+  log.running = true;
+  log.writer = std::thread(writerLoop);
+}
+
+void closeErrorFile() {
+  ErrorLog &log = errorLog();
+  {
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (!log.running)
+      return;
+    if (log.duplicates || log.rateLimited) {
+      queueLine(log, std::to_string(log.duplicates) +
+                         " repeated and " + std::to_string(log.rateLimited) +
+                         " rate limited GL messages suppressed");
+    }
+    log.running = false;
+  }
+  log.wake.notify_one();
+  log.writer.join();
+  log.file.close();
+}
+
+void reportError(const char *message) {
+  ErrorLog &log = errorLog();
+  std::lock_guard<std::mutex> lock(log.mutex);
+  queueLine(log, message);
+}
+
+#endif
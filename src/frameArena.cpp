@@ -0,0 +1,108 @@
+#include "frameArena.h"
+
+#include <algorithm>
+#include <new>
+
+namespace {
+
+// generations are unique across arenas so a thread never mistakes its
+// block for one of a different arena
+std::atomic<uint64_t> nextGeneration{1};
+
+// the block the calling thread bumps in
+struct ThreadBlock {
+  const FrameArena *arena = nullptr;
+  uint64_t generation = 0;
+  uintptr_t next = 0;
+  uintptr_t end = 0;
+};
+
+thread_local ThreadBlock threadBlock;
+
+uintptr_t alignUp(uintptr_t address, size_t alignment) {
+  return (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+}
+
+} // namespace
+
+FrameArena::FrameArena(size_t bytesPerFrame)
+    : frameCapacity(bytesPerFrame), generation(nextGeneration++) {
+  for (Frame &frame : frames)
+    frame.memory = new unsigned char[frameCapacity];
+}
+
+FrameArena::~FrameArena() {
+  for (Frame &frame : frames) {
+    releaseOverflow(frame);
+    delete[] frame.memory;
+  }
+  if (threadBlock.arena == this)
+    threadBlock = ThreadBlock();
+}
+
+void *FrameArena::allocate(size_t bytes, size_t alignment) {
+  ThreadBlock &block = threadBlock;
+  uint64_t frameGeneration = generation.load(std::memory_order_acquire);
+  if (block.arena != this || block.generation != frameGeneration)
+    block = ThreadBlock{this, frameGeneration, 0, 0};
+
+  uintptr_t address = alignUp(block.next, alignment);
+  if (block.next && address + bytes <= block.end) {
+    block.next = address + bytes;
+    return (void *)address;
+  }
+
+  // large requests go straight to the frame buffer, keeping the block
+  if (bytes + alignment > THREAD_BLOCK / 4) {
+    unsigned char *memory = reserve(bytes + alignment);
+    if (!memory)
+      return allocateOverflow(bytes, alignment);
+    return (void *)alignUp((uintptr_t)memory, alignment);
+  }
+
+  unsigned char *memory = reserve(THREAD_BLOCK);
+  if (!memory)
+    return allocateOverflow(bytes, alignment);
+  address = alignUp((uintptr_t)memory, alignment);
+  block.next = address + bytes;
+  block.end = (uintptr_t)memory + THREAD_BLOCK;
+  return (void *)address;
+}
+
+unsigned char *FrameArena::reserve(size_t bytes) {
+  Frame &frame = frames[current];
+  size_t offset = frame.used.fetch_add(bytes, std::memory_order_relaxed);
+  if (offset + bytes > frameCapacity)
+    return nullptr;
+  return frame.memory + offset;
+}
+
+void *FrameArena::allocateOverflow(size_t bytes, size_t alignment) {
+  overflows.fetch_add(1, std::memory_order_relaxed);
+  void *memory = ::operator new(bytes + alignment);
+
+  Frame &frame = frames[current];
+  std::lock_guard<std::mutex> lock(frame.overflowMutex);
+  frame.overflow.push_back(memory);
+  return (void *)alignUp((uintptr_t)memory, alignment);
+}
+
+void FrameArena::releaseOverflow(Frame &frame) {
+  for (void *memory : frame.overflow)
+    ::operator delete(memory);
+  frame.overflow.clear();
+}
+
+void FrameArena::nextFrame() {
+  // used keeps counting past the capacity, so the peak shows the demand
+  lastBytes = frames[current].used.load(std::memory_order_relaxed);
+  peakBytes = std::max(peakBytes, lastBytes);
+
+  current = (current + 1) % FRAMES;
+  Frame &frame = frames[current];
+  frame.used.store(0, std::memory_order_relaxed);
+  releaseOverflow(frame);
+
+  // blocks threads still hold point into an older frame
+  generation.store(nextGeneration++, std::memory_order_release);
+}
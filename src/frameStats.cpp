@@ -0,0 +1,144 @@
+#include "frameStats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+double percentile(std::vector<float> &values, double fraction) {
+  size_t index = (size_t)(fraction * (values.size() - 1) + 0.5);
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+} // namespace
+
+FrameStats::FrameStats(size_t capacity) : capacity(capacity) {
+  names.push_back("frame");
+  current.push_back(0.0);
+}
+
+unsigned int FrameStats::addPhase(const std::string &name) {
+  // the ring layout depends on the column count
+  samples.clear();
+  next = 0;
+  count = 0;
+
+  names.push_back(name);
+  current.push_back(0.0);
+  return (unsigned int)names.size() - 1;
+}
+
+void FrameStats::beginFrame() {
+  std::fill(current.begin(), current.end(), 0.0);
+  frameStart = Clock::now();
+  lastLap = frameStart;
+}
+
+void FrameStats::endFrame() {
+  addTime(0, Clock::now() - frameStart);
+
+  size_t columns = names.size();
+  if (samples.empty())
+    samples.resize(capacity * columns);
+
+  float *slot = &samples[next * columns];
+  for (size_t i = 0; i < columns; i++)
+    slot[i] = (float)current[i];
+
+  next = (next + 1) % capacity;
+  count = std::min(count + 1, capacity);
+}
+
+void FrameStats::addTime(unsigned int phase, Clock::duration time) {
+  current[phase] +=
+      std::chrono::duration<double, std::milli>(time).count();
+}
+
+void FrameStats::lap(unsigned int phase) {
+  Clock::time_point now = Clock::now();
+  addTime(phase, now - lastLap);
+  lastLap = now;
+}
+
+const float *FrameStats::row(size_t age) const {
+  // age 0 is the oldest frame held
+  size_t index = (next + capacity - count + age) % capacity;
+  return &samples[index * names.size()];
+}
+
+FrameStats::Summary FrameStats::summarize(unsigned int column) const {
+  Summary summary;
+  if (count == 0)
+    return summary;
+
+  std::vector<float> values(count);
+  double sum = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    values[i] = row(i)[column];
+    sum += values[i];
+  }
+
+  summary.mean = sum / count;
+  summary.max = *std::max_element(values.begin(), values.end());
+  summary.p50 = percentile(values, 0.50);
+  summary.p95 = percentile(values, 0.95);
+  summary.p99 = percentile(values, 0.99);
+  return summary;
+}
+
+void FrameStats::writeCsv(std::ostream &out) const {
+  for (size_t i = 0; i < names.size(); i++)
+    out << (i ? "," : "") << names[i] << "_ms";
+  out << "\n";
+
+  for (size_t frame = 0; frame < count; frame++) {
+    const float *values = row(frame);
+    for (size_t i = 0; i < names.size(); i++)
+      out << (i ? "," : "") << values[i];
+    out << "\n";
+  }
+}
+
+void FrameStats::writeJson(std::ostream &out) const {
+  out << "{\n  \"frames\": " << count << ",\n  \"phases\": {";
+  for (unsigned int i = 0; i < names.size(); i++) {
+    Summary s = summarize(i);
+    out << (i ? "," : "") << "\n    \"" << names[i] << "\": {"
+        << "\"mean_ms\": " << s.mean << ", \"p50_ms\": " << s.p50
+        << ", \"p95_ms\": " << s.p95 << ", \"p99_ms\": " << s.p99
+        << ", \"max_ms\": " << s.max << "}";
+  }
+  out << "\n  }\n}\n";
+}
+
+void FrameStats::printSummary(std::ostream &out) const {
+  out << "Frame stats over " << count << " frames (ms)\n";
+  out << std::left << std::setw(10) << "phase" << std::right;
+  for (const char *label : {"mean", "p50", "p95", "p99", "max"})
+    out << std::setw(9) << label;
+  out << "\n" << std::fixed << std::setprecision(3);
+
+  for (unsigned int i = 0; i < names.size(); i++) {
+    Summary s = summarize(i);
+    out << std::left << std::setw(10) << names[i] << std::right
+        << std::setw(9) << s.mean << std::setw(9) << s.p50 << std::setw(9)
+        << s.p95 << std::setw(9) << s.p99 << std::setw(9) << s.max << "\n";
+  }
+  out << std::defaultfloat << std::flush;
+}
+
+bool FrameStats::writeFile(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file)
+    return false;
+
+  bool json =
+      path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+  if (json)
+    writeJson(file);
+  else
+    writeCsv(file);
+  return (bool)file;
+}
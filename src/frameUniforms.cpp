@@ -0,0 +1,32 @@
+#include "frameUniforms.h"
+#include "glState.h"
+
+const char *const FrameUniforms::BLOCK_NAME = "FrameData";
+
+FrameUniforms::FrameUniforms() {
+  glGenBuffers(1, &UBO);
+  glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_STREAM_DRAW);
+  // binding the range also sets the generic binding, which now matches
+  // what glState() recorded
+  glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, UBO);
+}
+
+FrameUniforms::~FrameUniforms() {
+  glDeleteBuffers(1, &UBO);
+  glState().invalidate();
+}
+
+void FrameUniforms::attach(GLuint program) {
+  GLuint block = glGetUniformBlockIndex(program, BLOCK_NAME);
+  if (block != GL_INVALID_INDEX)
+    glUniformBlockBinding(program, block, BINDING);
+}
+
+void FrameUniforms::update(const FrameData &data) {
+  glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+  // fresh storage each frame, so the driver never waits for the GPU to be
+  // done with last frame's copy
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+}
@@ -0,0 +1,377 @@
+#include "frustumCulling.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULL_SSE2 1
+#include <immintrin.h>
+#endif
+
+// GCC and Clang can build an AVX2 path without compiling the whole program
+// for AVX2 and pick it at runtime, MSVC only when /arch:AVX2 is on
+#if defined(CULL_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define CULL_AVX2 1
+#define CULL_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(CULL_SSE2) && defined(__AVX2__)
+#define CULL_AVX2 1
+#define CULL_AVX2_TARGET
+#endif
+
+namespace {
+
+inline uint32_t lowestBit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (uint32_t)__builtin_ctz(mask);
+#else
+  uint32_t bit = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+// append base + bit for every set bit of mask
+inline size_t appendMask(uint32_t mask, uint32_t base, uint32_t *out) {
+  size_t written = 0;
+  while (mask) {
+    out[written++] = base + lowestBit(mask);
+    mask &= mask - 1;
+  }
+  return written;
+}
+
+size_t spheresScalar(const Frustum &frustum, const SphereSet &spheres,
+                     size_t begin, uint32_t *out) {
+  size_t written = 0;
+  for (size_t i = begin; i < spheres.size(); i++) {
+    bool inside = true;
+    for (const glm::vec4 &plane : frustum.planes) {
+      float distance = plane.x * spheres.x[i] + plane.y * spheres.y[i] +
+                       plane.z * spheres.z[i] + plane.w;
+      if (distance < -spheres.radius[i]) {
+        inside = false;
+        break;
+      }
+    }
+    if (inside)
+      out[written++] = (uint32_t)i;
+  }
+  return written;
+}
+
+size_t aabbsScalar(const Frustum &frustum, const AabbSet &boxes, size_t begin,
+                   uint32_t *out) {
+  size_t written = 0;
+  for (size_t i = begin; i < boxes.size(); i++) {
+    bool inside = true;
+    for (const glm::vec4 &plane : frustum.planes) {
+      float distance = plane.x * boxes.centerX[i] +
+                       plane.y * boxes.centerY[i] +
+                       plane.z * boxes.centerZ[i] + plane.w;
+      float reach = std::fabs(plane.x) * boxes.extentX[i] +
+                    std::fabs(plane.y) * boxes.extentY[i] +
+                    std::fabs(plane.z) * boxes.extentZ[i];
+      if (distance < -reach) {
+        inside = false;
+        break;
+      }
+    }
+    if (inside)
+      out[written++] = (uint32_t)i;
+  }
+  return written;
+}
+
+#ifdef CULL_SSE2
+
+// the vector paths add in the scalar order, ((a*x + b*y) + c*z) + d with no
+// fused multiply-add, so every path keeps or drops exactly the same objects
+
+size_t spheresSse2(const Frustum &frustum, const SphereSet &spheres,
+                   uint32_t *out, size_t &done) {
+  size_t count = spheres.size() & ~(size_t)3;
+  size_t written = 0;
+  for (size_t i = 0; i < count; i += 4) {
+    __m128 x = _mm_loadu_ps(&spheres.x[i]);
+    __m128 y = _mm_loadu_ps(&spheres.y[i]);
+    __m128 z = _mm_loadu_ps(&spheres.z[i]);
+    __m128 negRadius =
+        _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (const glm::vec4 &plane : frustum.planes) {
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x),
+                                _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+                     _mm_mul_ps(_mm_set1_ps(plane.z), z)),
+          _mm_set1_ps(plane.w));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+    }
+    written += appendMask((uint32_t)_mm_movemask_ps(inside), (uint32_t)i,
+                          out + written);
+  }
+  done = count;
+  return written;
+}
+
+size_t aabbsSse2(const Frustum &frustum, const AabbSet &boxes, uint32_t *out,
+                 size_t &done) {
+  size_t count = boxes.size() & ~(size_t)3;
+  size_t written = 0;
+  for (size_t i = 0; i < count; i += 4) {
+    __m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+    __m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+    __m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+    __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+    __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+    __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (const glm::vec4 &plane : frustum.planes) {
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx),
+                                _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                     _mm_mul_ps(_mm_set1_ps(plane.z), cz)),
+          _mm_set1_ps(plane.w));
+      __m128 reach = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), ex),
+                     _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), ey)),
+          _mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), ez));
+      __m128 negReach = _mm_sub_ps(_mm_setzero_ps(), reach);
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negReach));
+    }
+    written += appendMask((uint32_t)_mm_movemask_ps(inside), (uint32_t)i,
+                          out + written);
+  }
+  done = count;
+  return written;
+}
+
+#endif
+
+#ifdef CULL_AVX2
+
+CULL_AVX2_TARGET size_t spheresAvx2(const Frustum &frustum,
+                                    const SphereSet &spheres, uint32_t *out,
+                                    size_t &done) {
+  size_t count = spheres.size() & ~(size_t)7;
+  size_t written = 0;
+  for (size_t i = 0; i < count; i += 8) {
+    __m256 x = _mm256_loadu_ps(&spheres.x[i]);
+    __m256 y = _mm256_loadu_ps(&spheres.y[i]);
+    __m256 z = _mm256_loadu_ps(&spheres.z[i]);
+    __m256 negRadius =
+        _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (const glm::vec4 &plane : frustum.planes) {
+      __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(
+              _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), x),
+                            _mm256_mul_ps(_mm256_set1_ps(plane.y), y)),
+              _mm256_mul_ps(_mm256_set1_ps(plane.z), z)),
+          _mm256_set1_ps(plane.w));
+      inside = _mm256_and_ps(inside,
+                             _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+    }
+    written += appendMask((uint32_t)_mm256_movemask_ps(inside), (uint32_t)i,
+                          out + written);
+  }
+  done = count;
+  return written;
+}
+
+CULL_AVX2_TARGET size_t aabbsAvx2(const Frustum &frustum,
+                                  const AabbSet &boxes, uint32_t *out,
+                                  size_t &done) {
+  size_t count = boxes.size() & ~(size_t)7;
+  size_t written = 0;
+  for (size_t i = 0; i < count; i += 8) {
+    __m256 cx = _mm256_loadu_ps(&boxes.centerX[i]);
+    __m256 cy = _mm256_loadu_ps(&boxes.centerY[i]);
+    __m256 cz = _mm256_loadu_ps(&boxes.centerZ[i]);
+    __m256 ex = _mm256_loadu_ps(&boxes.extentX[i]);
+    __m256 ey = _mm256_loadu_ps(&boxes.extentY[i]);
+    __m256 ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (const glm::vec4 &plane : frustum.planes) {
+      __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(
+              _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx),
+                            _mm256_mul_ps(_mm256_set1_ps(plane.y), cy)),
+              _mm256_mul_ps(_mm256_set1_ps(plane.z), cz)),
+          _mm256_set1_ps(plane.w));
+      __m256 reach = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.x)), ex),
+                        _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.y)), ey)),
+          _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.z)), ez));
+      __m256 negReach = _mm256_sub_ps(_mm256_setzero_ps(), reach);
+      inside = _mm256_and_ps(inside,
+                             _mm256_cmp_ps(distance, negReach, _CMP_GE_OQ));
+    }
+    written += appendMask((uint32_t)_mm256_movemask_ps(inside), (uint32_t)i,
+                          out + written);
+  }
+  done = count;
+  return written;
+}
+
+#endif
+
+CullPath resolvePath(CullPath path) {
+  if (path != CullPath::Best)
+    return cullPathSupported(path) ? path : CullPath::Scalar;
+  if (cullPathSupported(CullPath::Avx2))
+    return CullPath::Avx2;
+  if (cullPathSupported(CullPath::Sse2))
+    return CullPath::Sse2;
+  return CullPath::Scalar;
+}
+
+} // namespace
+
+Frustum extractFrustum(const glm::mat4 &m) {
+  // rows of the matrix, glm stores columns
+  glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+  glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+  glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+  glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  Frustum frustum;
+  frustum.planes[0] = row3 + row0; // left
+  frustum.planes[1] = row3 - row0; // right
+  frustum.planes[2] = row3 + row1; // bottom
+  frustum.planes[3] = row3 - row1; // top
+  frustum.planes[4] = row3 + row2; // near
+  frustum.planes[5] = row3 - row2; // far
+
+  for (glm::vec4 &plane : frustum.planes) {
+    float length = std::sqrt(plane.x * plane.x + plane.y * plane.y +
+                             plane.z * plane.z);
+    plane = plane * (1.0f / length);
+  }
+  return frustum;
+}
+
+void SphereSet::add(const glm::vec3 &center, float r) {
+  x.push_back(center.x);
+  y.push_back(center.y);
+  z.push_back(center.z);
+  radius.push_back(r);
+}
+
+void SphereSet::clear() {
+  x.clear();
+  y.clear();
+  z.clear();
+  radius.clear();
+}
+
+void AabbSet::add(const glm::vec3 &min, const glm::vec3 &max) {
+  centerX.push_back((min.x + max.x) * 0.5f);
+  centerY.push_back((min.y + max.y) * 0.5f);
+  centerZ.push_back((min.z + max.z) * 0.5f);
+  extentX.push_back((max.x - min.x) * 0.5f);
+  extentY.push_back((max.y - min.y) * 0.5f);
+  extentZ.push_back((max.z - min.z) * 0.5f);
+}
+
+void AabbSet::clear() {
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  extentX.clear();
+  extentY.clear();
+  extentZ.clear();
+}
+
+bool cullPathSupported(CullPath path) {
+  switch (path) {
+  case CullPath::Scalar:
+  case CullPath::Best:
+    return true;
+  case CullPath::Sse2:
+#ifdef CULL_SSE2
+    return true;
+#else
+    return false;
+#endif
+  case CullPath::Avx2:
+#if defined(CULL_AVX2) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#elif defined(CULL_AVX2)
+    return true;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+const char *cullPathName(CullPath path) {
+  switch (resolvePath(path)) {
+  case CullPath::Avx2:
+    return "avx2";
+  case CullPath::Sse2:
+    return "sse2";
+  default:
+    return "scalar";
+  }
+}
+
+size_t cullSpheres(const Frustum &frustum, const SphereSet &spheres,
+                   std::vector<uint32_t> &visible, CullPath path) {
+  // sized for the worst case, trimmed at the end; capacity is kept
+  visible.resize(spheres.size());
+  size_t done = 0;
+  size_t written = 0;
+
+  switch (resolvePath(path)) {
+#ifdef CULL_AVX2
+  case CullPath::Avx2:
+    written = spheresAvx2(frustum, spheres, visible.data(), done);
+    break;
+#endif
+#ifdef CULL_SSE2
+  case CullPath::Sse2:
+    written = spheresSse2(frustum, spheres, visible.data(), done);
+    break;
+#endif
+  default:
+    break;
+  }
+
+  written += spheresScalar(frustum, spheres, done, visible.data() + written);
+  visible.resize(written);
+  return written;
+}
+
+size_t cullAabbs(const Frustum &frustum, const AabbSet &boxes,
+                 std::vector<uint32_t> &visible, CullPath path) {
+  visible.resize(boxes.size());
+  size_t done = 0;
+  size_t written = 0;
+
+  switch (resolvePath(path)) {
+#ifdef CULL_AVX2
+  case CullPath::Avx2:
+    written = aabbsAvx2(frustum, boxes, visible.data(), done);
+    break;
+#endif
+#ifdef CULL_SSE2
+  case CullPath::Sse2:
+    written = aabbsSse2(frustum, boxes, visible.data(), done);
+    break;
+#endif
+  default:
+    break;
+  }
+
+  written += aabbsScalar(frustum, boxes, done, visible.data() + written);
+  visible.resize(written);
+  return written;
+}
@@ -0,0 +1,109 @@
+#include "glExtensions.h"
+
+#include <cstring>
+
+int GLEXT_ARB_get_program_binary = 0;
+PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC glext_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri = NULL;
+
+int GLEXT_KHR_debug = 0;
+PFNGLDEBUGMESSAGECALLBACKPROC glext_glDebugMessageCallback = NULL;
+PFNGLDEBUGMESSAGECONTROLPROC glext_glDebugMessageControl = NULL;
+
+int GLEXT_ARB_buffer_storage = 0;
+PFNGLBUFFERSTORAGEPROC glext_glBufferStorage = NULL;
+
+int GLEXT_ARB_multi_draw_indirect = 0;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect = NULL;
+
+int GLEXT_ARB_compute_shader = 0;
+PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute = NULL;
+PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier = NULL;
+
+int GLEXT_KHR_parallel_shader_compile = 0;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR =
+    NULL;
+
+int GLEXT_EXT_texture_compression_s3tc = 0;
+int GLEXT_ARB_texture_compression_bptc = 0;
+int GLEXT_ARB_ES3_compatibility = 0;
+
+bool hasGlExtension(const char *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; i++) {
+    const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+    if (extension && std::strcmp(extension, name) == 0)
+      return true;
+  }
+  return false;
+}
+
+bool hasGlVersion(int major, int minor) {
+  return GLVersion.major > major ||
+         (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+void loadGlExtensions(GLADloadproc load) {
+  if (hasGlVersion(4, 1) || hasGlExtension("GL_ARB_get_program_binary")) {
+    glext_glGetProgramBinary =
+        (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+    glext_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+    glext_glProgramParameteri =
+        (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+    GLEXT_ARB_get_program_binary = glext_glGetProgramBinary &&
+                                   glext_glProgramBinary &&
+                                   glext_glProgramParameteri;
+  }
+
+  if (hasGlVersion(4, 3) || hasGlExtension("GL_KHR_debug")) {
+    glext_glDebugMessageCallback =
+        (PFNGLDEBUGMESSAGECALLBACKPROC)load("glDebugMessageCallback");
+    glext_glDebugMessageControl =
+        (PFNGLDEBUGMESSAGECONTROLPROC)load("glDebugMessageControl");
+  }
+  GLEXT_KHR_debug =
+      glext_glDebugMessageCallback && glext_glDebugMessageControl;
+
+  if (hasGlVersion(4, 4) || hasGlExtension("GL_ARB_buffer_storage"))
+    glext_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+  GLEXT_ARB_buffer_storage = glext_glBufferStorage != NULL;
+
+  if (hasGlVersion(4, 3) || (hasGlExtension("GL_ARB_multi_draw_indirect") &&
+                             hasGlExtension("GL_ARB_base_instance")))
+    glext_glMultiDrawElementsIndirect =
+        (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+  GLEXT_ARB_multi_draw_indirect = glext_glMultiDrawElementsIndirect != NULL;
+
+  if (hasGlVersion(4, 3) ||
+      (hasGlExtension("GL_ARB_compute_shader") &&
+       hasGlExtension("GL_ARB_shader_storage_buffer_object"))) {
+    glext_glDispatchCompute =
+        (PFNGLDISPATCHCOMPUTEPROC)load("glDispatchCompute");
+    glext_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)load("glMemoryBarrier");
+  }
+  GLEXT_ARB_compute_shader =
+      glext_glDispatchCompute && glext_glMemoryBarrier;
+
+  if (hasGlExtension("GL_KHR_parallel_shader_compile"))
+    glext_glMaxShaderCompilerThreadsKHR =
+        (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load(
+            "glMaxShaderCompilerThreadsKHR");
+  else if (hasGlExtension("GL_ARB_parallel_shader_compile"))
+    glext_glMaxShaderCompilerThreadsKHR =
+        (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load(
+            "glMaxShaderCompilerThreadsARB");
+  GLEXT_KHR_parallel_shader_compile =
+      glext_glMaxShaderCompilerThreadsKHR != NULL;
+  // let the driver use as many threads as it likes
+  if (GLEXT_KHR_parallel_shader_compile)
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+
+  GLEXT_EXT_texture_compression_s3tc =
+      hasGlExtension("GL_EXT_texture_compression_s3tc");
+  GLEXT_ARB_texture_compression_bptc =
+      hasGlVersion(4, 2) || hasGlExtension("GL_ARB_texture_compression_bptc");
+  GLEXT_ARB_ES3_compatibility =
+      hasGlVersion(4, 3) || hasGlExtension("GL_ARB_ES3_compatibility");
+}
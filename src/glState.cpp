@@ -0,0 +1,207 @@
+#include "glState.h"
+#include "glExtensions.h"
+
+namespace {
+
+int textureSlot(GLenum target) {
+  switch (target) {
+  case GL_TEXTURE_2D:
+    return 0;
+  case GL_TEXTURE_CUBE_MAP:
+    return 1;
+  case GL_TEXTURE_2D_ARRAY:
+    return 2;
+  case GL_TEXTURE_3D:
+    return 3;
+  default:
+    return -1;
+  }
+}
+
+int bufferSlot(GLenum target) {
+  switch (target) {
+  case GL_ARRAY_BUFFER:
+    return 0;
+  case GL_PIXEL_UNPACK_BUFFER:
+    return 1;
+  case GL_PIXEL_PACK_BUFFER:
+    return 2;
+  case GL_UNIFORM_BUFFER:
+    return 3;
+  case GL_COPY_READ_BUFFER:
+    return 4;
+  case GL_COPY_WRITE_BUFFER:
+    return 5;
+  case GL_TEXTURE_BUFFER:
+    return 6;
+  case GL_TRANSFORM_FEEDBACK_BUFFER:
+    return 7;
+  case GL_DRAW_INDIRECT_BUFFER:
+    return 8;
+  case GL_SHADER_STORAGE_BUFFER:
+    return 9;
+  default:
+    return -1;
+  }
+}
+
+int capabilitySlot(GLenum capability) {
+  switch (capability) {
+  case GL_DEPTH_TEST:
+    return 0;
+  case GL_BLEND:
+    return 1;
+  case GL_CULL_FACE:
+    return 2;
+  default:
+    return -1;
+  }
+}
+
+} // namespace
+
+GlState &glState() {
+  static GlState state;
+  return state;
+}
+
+void GlState::useProgram(GLuint value) {
+  if (change(program, value))
+    glUseProgram(value);
+}
+
+void GlState::bindVertexArray(GLuint vao) {
+  if (change(vertexArray, vao))
+    glBindVertexArray(vao);
+}
+
+void GlState::bindFramebuffer(GLenum target, GLuint framebuffer) {
+  if (target == GL_FRAMEBUFFER) {
+    if (drawFramebuffer == framebuffer && readFramebuffer == framebuffer) {
+      change(drawFramebuffer, framebuffer);
+      return;
+    }
+    drawFramebuffer = readFramebuffer = framebuffer;
+    passThrough();
+    glBindFramebuffer(target, framebuffer);
+    return;
+  }
+
+  GLuint &cached =
+      target == GL_READ_FRAMEBUFFER ? readFramebuffer : drawFramebuffer;
+  if (change(cached, framebuffer))
+    glBindFramebuffer(target, framebuffer);
+}
+
+void GlState::bindBuffer(GLenum target, GLuint buffer) {
+  int slot = bufferSlot(target);
+  if (slot < 0) {
+    passThrough();
+    glBindBuffer(target, buffer);
+    return;
+  }
+  if (change(buffers[slot], buffer))
+    glBindBuffer(target, buffer);
+}
+
+void GlState::activeTexture(unsigned int unit) {
+  if (change(activeUnit, unit))
+    glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GlState::bindTexture(GLenum target, GLuint texture) {
+  int slot = textureSlot(target);
+  if (slot < 0 || activeUnit >= MAX_TEXTURE_UNITS) {
+    passThrough();
+    glBindTexture(target, texture);
+    return;
+  }
+  if (change(textures[activeUnit][slot], texture))
+    glBindTexture(target, texture);
+}
+
+void GlState::bindTexture(unsigned int unit, GLenum target, GLuint texture) {
+  int slot = textureSlot(target);
+  // skip the unit switch too when the texture is already there
+  if (slot >= 0 && unit < MAX_TEXTURE_UNITS &&
+      textures[unit][slot] == texture) {
+    elide();
+    return;
+  }
+  activeTexture(unit);
+  bindTexture(target, texture);
+}
+
+void GlState::enable(GLenum capability) {
+  int slot = capabilitySlot(capability);
+  if (slot >= 0 && capabilities[slot] == 1) {
+    elide();
+    return;
+  }
+  if (slot >= 0)
+    capabilities[slot] = 1;
+  passThrough();
+  glEnable(capability);
+}
+
+void GlState::disable(GLenum capability) {
+  int slot = capabilitySlot(capability);
+  if (slot >= 0 && capabilities[slot] == 0) {
+    elide();
+    return;
+  }
+  if (slot >= 0)
+    capabilities[slot] = 0;
+  passThrough();
+  glDisable(capability);
+}
+
+void GlState::depthFunc(GLenum func) {
+  if (change(depthFunction, func))
+    glDepthFunc(func);
+}
+
+void GlState::depthMask(GLboolean mask) {
+  if (depthWrite == (int)mask) {
+    elide();
+    return;
+  }
+  depthWrite = mask;
+  passThrough();
+  glDepthMask(mask);
+}
+
+void GlState::blendFunc(GLenum source, GLenum destination) {
+  if (blendSource == source && blendDestination == destination) {
+    elide();
+    return;
+  }
+  blendSource = source;
+  blendDestination = destination;
+  passThrough();
+  glBlendFunc(source, destination);
+}
+
+void GlState::invalidate() {
+  program = UNKNOWN;
+  vertexArray = UNKNOWN;
+  drawFramebuffer = UNKNOWN;
+  readFramebuffer = UNKNOWN;
+  for (GLuint &buffer : buffers)
+    buffer = UNKNOWN;
+  activeUnit = UNKNOWN;
+  for (auto &unit : textures)
+    for (GLuint &texture : unit)
+      texture = UNKNOWN;
+  for (int &capability : capabilities)
+    capability = -1;
+  depthFunction = UNKNOWN;
+  depthWrite = -1;
+  blendSource = UNKNOWN;
+  blendDestination = UNKNOWN;
+}
+
+void GlState::beginFrame() {
+  previous = current;
+  current = Counters();
+}
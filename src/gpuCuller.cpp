@@ -0,0 +1,104 @@
+#include "gpuCuller.h"
+#include "frustumCulling.h"
+#include "glExtensions.h"
+#include "glState.h"
+
+namespace {
+
+// binding points declared in cull.comp
+const GLuint BOUNDS_BINDING = 0;
+const GLuint MODELS_BINDING = 1;
+const GLuint VISIBLE_BINDING = 2;
+const GLuint COMMAND_BINDING = 3;
+
+void bindStorage(GLuint index, GLuint buffer) {
+  // binding the index also sets the generic binding, which now matches
+  // what glState() recorded
+  glState().bindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, buffer);
+}
+
+} // namespace
+
+bool GpuCuller::supported() {
+  return GLEXT_ARB_compute_shader && GLEXT_ARB_multi_draw_indirect;
+}
+
+GpuCuller::GpuCuller(ShaderCompiler &compiler)
+    : program("cull.comp", compiler) {
+  programChanged();
+
+  glGenBuffers(1, &bounds);
+  glGenBuffers(1, &models);
+  glGenBuffers(1, &visible);
+  glGenBuffers(1, &commands);
+
+  glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commands);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand),
+               NULL, GL_DYNAMIC_DRAW);
+}
+
+void GpuCuller::programChanged() {
+  planesUniform = program.uniform("planes"_u);
+  countUniform = program.uniform("instanceCount"_u);
+}
+
+GpuCuller::~GpuCuller() {
+  glDeleteBuffers(1, &bounds);
+  glDeleteBuffers(1, &models);
+  glDeleteBuffers(1, &visible);
+  glDeleteBuffers(1, &commands);
+  glDeleteProgram(program.ID);
+  glState().invalidate();
+}
+
+void GpuCuller::setInstances(const SphereSet &spheres,
+                             const std::vector<glm::mat4> &matrices) {
+  count = (unsigned int)spheres.size();
+
+  std::vector<glm::vec4> packed(count);
+  for (unsigned int i = 0; i < count; i++)
+    packed[i] = glm::vec4(spheres.x[i], spheres.y[i], spheres.z[i],
+                          spheres.radius[i]);
+  glState().bindBuffer(GL_SHADER_STORAGE_BUFFER, bounds);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(glm::vec4),
+               packed.data(), GL_STATIC_DRAW);
+
+  // every instance may survive, so the visible buffer holds all of them
+  glState().bindBuffer(GL_SHADER_STORAGE_BUFFER, visible);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(glm::mat4), NULL,
+               GL_DYNAMIC_COPY);
+
+  updateModels(matrices);
+}
+
+void GpuCuller::updateModels(const std::vector<glm::mat4> &matrices) {
+  glState().bindBuffer(GL_SHADER_STORAGE_BUFFER, models);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(glm::mat4),
+               matrices.data(), GL_DYNAMIC_DRAW);
+}
+
+void GpuCuller::cull(const Frustum &frustum, const MeshBatch::Mesh &mesh) {
+  // the pass only ever adds to instanceCount
+  DrawElementsIndirectCommand command{mesh.indexCount, 0, mesh.firstIndex,
+                                      mesh.baseVertex, 0};
+  glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commands);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+  if (count == 0)
+    return;
+
+  program.use();
+  glUniform4fv(planesUniform.location, 6, &frustum.planes[0].x);
+  program.setInt(countUniform, (int)count);
+
+  bindStorage(BOUNDS_BINDING, bounds);
+  bindStorage(MODELS_BINDING, models);
+  bindStorage(VISIBLE_BINDING, visible);
+  bindStorage(COMMAND_BINDING, commands);
+  glDispatchCompute((count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+
+  // the indirect draw reads the command, the vertex fetch the matrices, and
+  // next frame's glBufferSubData resets the count this pass added to
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                  GL_BUFFER_UPDATE_BARRIER_BIT);
+}
@@ -0,0 +1,130 @@
+#include "gpuTimer.h"
+
+#include <algorithm>
+#include <iomanip>
+
+GpuTimer::GpuTimer(unsigned int latency) : frames(std::max(1u, latency)) {}
+
+GpuTimer::~GpuTimer() {
+  for (FrameQueries &frame : frames)
+    if (!frame.queries.empty())
+      glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+}
+
+unsigned int GpuTimer::addPass(const std::string &name) {
+  PassStats pass;
+  pass.name = name;
+  stats.push_back(pass);
+  return (unsigned int)stats.size() - 1;
+}
+
+void GpuTimer::createQueries() {
+  for (FrameQueries &frame : frames) {
+    frame.queries.resize(stats.size() * 2);
+    frame.issued.assign(stats.size(), false);
+    glGenQueries((GLsizei)frame.queries.size(), frame.queries.data());
+  }
+}
+
+void GpuTimer::beginFrame() {
+  if (frames[0].queries.empty()) {
+    if (stats.empty())
+      return;
+    createQueries();
+  }
+
+  current = (current + 1) % frames.size();
+  FrameQueries &frame = frames[current];
+  if (frame.pending)
+    collect(frame);
+
+  std::fill(frame.issued.begin(), frame.issued.end(), false);
+  frame.pending = true;
+}
+
+void GpuTimer::finish() {
+  glFinish();
+  // oldest first so lastMs ends up holding the newest frame
+  for (size_t i = 1; i <= frames.size(); i++) {
+    FrameQueries &frame = frames[(current + i) % frames.size()];
+    if (frame.pending)
+      collect(frame);
+  }
+}
+
+void GpuTimer::begin(unsigned int pass) {
+  FrameQueries &frame = frames[current];
+  if (frame.queries.empty())
+    return;
+  glQueryCounter(frame.queries[pass * 2], GL_TIMESTAMP);
+}
+
+void GpuTimer::end(unsigned int pass) {
+  FrameQueries &frame = frames[current];
+  if (frame.queries.empty())
+    return;
+  glQueryCounter(frame.queries[pass * 2 + 1], GL_TIMESTAMP);
+  frame.issued[pass] = true;
+}
+
+void GpuTimer::collect(FrameQueries &frame) {
+  frame.pending = false;
+
+  // results complete in order, so the last end query covers the frame
+  GLuint last = 0;
+  for (size_t pass = 0; pass < stats.size(); pass++)
+    if (frame.issued[pass])
+      last = frame.queries[pass * 2 + 1];
+  if (!last)
+    return;
+
+  GLint available = 0;
+  glGetQueryObjectiv(last, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    dropped++;
+    return;
+  }
+
+  for (size_t pass = 0; pass < stats.size(); pass++) {
+    if (!frame.issued[pass])
+      continue;
+
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(frame.queries[pass * 2], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(frame.queries[pass * 2 + 1], GL_QUERY_RESULT, &end);
+    double ms = (end - start) / 1.0e6;
+
+    PassStats &passStats = stats[pass];
+    passStats.minMs = passStats.samples ? std::min(passStats.minMs, ms) : ms;
+    passStats.maxMs = std::max(passStats.maxMs, ms);
+    passStats.totalMs += ms;
+    passStats.lastMs = ms;
+    passStats.samples++;
+  }
+}
+
+void GpuTimer::reset() {
+  for (PassStats &pass : stats) {
+    pass.samples = 0;
+    pass.totalMs = pass.minMs = pass.maxMs = pass.lastMs = 0.0;
+  }
+  dropped = 0;
+}
+
+void GpuTimer::printSummary(std::ostream &out) const {
+  out << "GPU pass times (ms), " << dropped << " frames dropped\n";
+  out << std::left << std::setw(10) << "pass" << std::right;
+  for (const char *label : {"mean", "min", "max", "last"})
+    out << std::setw(9) << label;
+  out << std::setw(9) << "samples"
+      << "\n"
+      << std::fixed << std::setprecision(3);
+
+  for (const PassStats &pass : stats) {
+    out << std::left << std::setw(10) << pass.name << std::right
+        << std::setw(9) << pass.meanMs() << std::setw(9) << pass.minMs
+        << std::setw(9) << pass.maxMs << std::setw(9) << pass.lastMs
+        << std::setw(9) << pass.samples << "\n";
+  }
+  out << std::defaultfloat << std::flush;
+}
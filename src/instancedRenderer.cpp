@@ -0,0 +1,78 @@
+#include "instancedRenderer.h"
+#include "glState.h"
+
+InstancedRenderer::InstancedRenderer(unsigned int vao,
+                                     const std::vector<glm::mat4> &models)
+    : VAO(vao) {
+  glGenBuffers(1, &instanceVBO);
+
+  glState().bindVertexArray(VAO);
+  for (unsigned int i = 0; i < 4; i++) {
+    glEnableVertexAttribArray(MODEL_ATTRIBUTE + i);
+    glVertexAttribDivisor(MODEL_ATTRIBUTE + i, 1);
+  }
+  sourceBuffer = instanceVBO;
+  pointAttributes(instanceVBO, 0);
+  glState().bindVertexArray(0);
+
+  update(models);
+}
+
+void InstancedRenderer::pointAttributes(unsigned int buffer, size_t offset) {
+  pointedBuffer = buffer;
+  pointedOffset = offset;
+
+  // a mat4 attribute is four vec4 columns in consecutive locations
+  glState().bindVertexArray(VAO);
+  glState().bindBuffer(GL_ARRAY_BUFFER, buffer);
+  for (unsigned int i = 0; i < 4; i++)
+    glVertexAttribPointer(MODEL_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(glm::mat4),
+                          (void *)(offset + i * sizeof(glm::vec4)));
+}
+
+InstancedRenderer::~InstancedRenderer() {
+  glDeleteBuffers(1, &instanceVBO);
+  glState().invalidate();
+}
+
+void InstancedRenderer::update(const std::vector<glm::mat4> &models) {
+  update(models.data(), (unsigned int)models.size());
+}
+
+void InstancedRenderer::update(const glm::mat4 *models,
+                               unsigned int modelCount) {
+  count = modelCount;
+  sourceBuffer = instanceVBO;
+  sourceOffset = 0;
+  setFirstInstance(0);
+
+  glState().bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  if (count > capacity) {
+    capacity = count;
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::mat4), models,
+                 GL_STATIC_DRAW);
+  } else if (count > 0) {
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), models);
+  }
+}
+
+void InstancedRenderer::attach(unsigned int buffer, size_t offset,
+                               unsigned int modelCount) {
+  count = modelCount;
+  sourceBuffer = buffer;
+  sourceOffset = offset;
+  setFirstInstance(0);
+}
+
+void InstancedRenderer::setFirstInstance(unsigned int first) {
+  size_t offset = sourceOffset + first * sizeof(glm::mat4);
+  if (pointedBuffer != sourceBuffer || pointedOffset != offset)
+    pointAttributes(sourceBuffer, offset);
+}
+
+void InstancedRenderer::draw(GLenum mode, GLint first,
+                             GLsizei vertexCount) const {
+  glState().bindVertexArray(VAO);
+  glDrawArraysInstanced(mode, first, vertexCount, count);
+}
@@ -0,0 +1,297 @@
+#include "jobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+
+struct JobSystem::Job {
+  std::function<void()> function;
+  Counter *counter;
+};
+
+namespace {
+
+// idle rounds before a worker goes to sleep
+const int SPIN_ROUNDS = 64;
+
+struct LocalWorker {
+  const JobSystem *system;
+  unsigned int index;
+};
+
+// the systems this thread is a worker of; the creating thread can belong
+// to several at once, so membership is looked up per system
+thread_local std::vector<LocalWorker> localWorkers;
+
+bool workerIndex(const JobSystem *system, unsigned int &index) {
+  for (const LocalWorker &worker : localWorkers)
+    if (worker.system == system) {
+      index = worker.index;
+      return true;
+    }
+  return false;
+}
+
+void leaveSystem(const JobSystem *system) {
+  localWorkers.erase(std::remove_if(localWorkers.begin(), localWorkers.end(),
+                                    [system](const LocalWorker &worker) {
+                                      return worker.system == system;
+                                    }),
+                     localWorkers.end());
+}
+
+uint32_t nextRandom(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+} // namespace
+
+// Le, Pop, Cohen and Zappa Nardelli's C11 version of the Chase-Lev deque
+bool JobSystem::Deque::push(Job *job) {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+  if (b - t >= CAPACITY)
+    return false;
+  jobs[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b + 1, std::memory_order_relaxed);
+  return true;
+}
+
+JobSystem::Job *JobSystem::Deque::pop() {
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+
+  if (t > b) {
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  Job *job = jobs[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (t == b) {
+    // last job, race the thieves for it
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      job = nullptr;
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+JobSystem::Job *JobSystem::Deque::steal() {
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b)
+    return nullptr;
+
+  Job *job = jobs[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                   std::memory_order_relaxed))
+    return nullptr;
+  return job;
+}
+
+JobSystem::JobSystem(unsigned int workerCount) {
+  if (workerCount == 0)
+    workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned int i = 0; i < workerCount; i++)
+    deques.emplace_back(new Deque());
+
+  localWorkers.push_back(LocalWorker{this, 0});
+
+  workers.reserve(workerCount - 1);
+  for (unsigned int i = 1; i < workerCount; i++)
+    workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+  stopping.store(true);
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    wake.notify_all();
+  }
+  for (std::thread &worker : workers)
+    worker.join();
+
+  // drop whatever was never run
+  for (std::unique_ptr<Deque> &deque : deques)
+    while (Job *job = deque->pop())
+      delete job;
+  for (Job *job : injected)
+    delete job;
+
+  leaveSystem(this);
+}
+
+void JobSystem::run(std::function<void()> job, Counter *counter) {
+  if (counter)
+    counter->value.fetch_add(1, std::memory_order_relaxed);
+  schedule(new Job{std::move(job), counter});
+}
+
+void JobSystem::runAfter(Counter &dependency, std::function<void()> job,
+                         Counter *counter) {
+  if (counter)
+    counter->value.fetch_add(1, std::memory_order_relaxed);
+  Job *waiting = new Job{std::move(job), counter};
+
+  // the last job on dependency takes the same lock before releasing its
+  // waiters, so a job is either queued here or released there
+  {
+    std::lock_guard<std::mutex> lock(dependency.mutex);
+    if (!dependency.done()) {
+      dependency.waiting.push_back(waiting);
+      return;
+    }
+  }
+  schedule(waiting);
+}
+
+void JobSystem::wait(Counter &counter) {
+  unsigned int index = 0;
+  bool member = workerIndex(this, index);
+  uint32_t seed = 0x9e3779b9u;
+  while (!counter.done()) {
+    // a thread outside the system owns no deque, it steals and drains the
+    // injected queue instead, which is all there is to run when the system
+    // has no worker threads
+    Job *job = member ? findJob(index, seed) : findForeignJob(seed);
+    if (job)
+      execute(job);
+    else
+      std::this_thread::yield();
+  }
+  // wait for the thread that finished the last job to let go of the counter
+  std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain,
+                            const std::function<void(size_t, size_t)> &body) {
+  if (end <= begin)
+    return;
+  grain = std::max<size_t>(1, grain);
+
+  Counter counter;
+  std::function<void(size_t, size_t)> split = [&](size_t first,
+                                                  size_t last) {
+    // hand off the upper half until what is left fits in one grain
+    while (last - first > grain) {
+      size_t middle = first + (last - first) / 2;
+      run([&split, middle, last] { split(middle, last); }, &counter);
+      last = middle;
+    }
+    body(first, last);
+  };
+  split(begin, end);
+  wait(counter);
+}
+
+void JobSystem::schedule(Job *job) {
+  unsigned int index = 0;
+  if (workerIndex(this, index)) {
+    if (!deques[index]->push(job)) {
+      execute(job);
+      return;
+    }
+  } else {
+    std::lock_guard<std::mutex> lock(injectedMutex);
+    injected.push_back(job);
+    injectedCount.fetch_add(1, std::memory_order_release);
+  }
+
+  if (sleeping.load(std::memory_order_acquire) > 0) {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    wake.notify_one();
+  }
+}
+
+JobSystem::Job *JobSystem::findJob(unsigned int index, uint32_t &seed) {
+  if (Job *job = deques[index]->pop())
+    return job;
+
+  unsigned int count = (unsigned int)deques.size();
+  unsigned int start = nextRandom(seed) % count;
+  for (unsigned int i = 0; i < count; i++) {
+    unsigned int victim = (start + i) % count;
+    if (victim == index)
+      continue;
+    if (Job *job = deques[victim]->steal())
+      return job;
+  }
+  return popInjected();
+}
+
+JobSystem::Job *JobSystem::findForeignJob(uint32_t &seed) {
+  if (Job *job = popInjected())
+    return job;
+
+  unsigned int count = (unsigned int)deques.size();
+  unsigned int start = nextRandom(seed) % count;
+  for (unsigned int i = 0; i < count; i++)
+    if (Job *job = deques[(start + i) % count]->steal())
+      return job;
+  return nullptr;
+}
+
+JobSystem::Job *JobSystem::popInjected() {
+  if (injectedCount.load(std::memory_order_acquire) == 0)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(injectedMutex);
+  if (injected.empty())
+    return nullptr;
+  Job *job = injected.front();
+  injected.pop_front();
+  injectedCount.fetch_sub(1, std::memory_order_relaxed);
+  return job;
+}
+
+void JobSystem::execute(Job *job) {
+  job->function();
+
+  Counter *counter = job->counter;
+  delete job;
+  if (!counter)
+    return;
+
+  // decremented under the lock so wait() cannot return, and the counter go
+  // away, while this thread still touches it
+  std::vector<Job *> released;
+  {
+    std::lock_guard<std::mutex> lock(counter->mutex);
+    if (counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      released.swap(counter->waiting);
+  }
+  // counter reached zero, release the jobs that depend on it
+  for (Job *waiting : released)
+    schedule(waiting);
+}
+
+void JobSystem::workerLoop(unsigned int index) {
+  localWorkers.push_back(LocalWorker{this, index});
+  uint32_t seed = 0x9e3779b9u * (index + 1);
+
+  int idle = 0;
+  while (!stopping.load(std::memory_order_relaxed)) {
+    if (Job *job = findJob(index, seed)) {
+      execute(job);
+      idle = 0;
+    } else if (++idle < SPIN_ROUNDS) {
+      std::this_thread::yield();
+    } else {
+      // the timeout covers a wakeup sent just before sleeping went up
+      sleeping.fetch_add(1, std::memory_order_acq_rel);
+      {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (!stopping.load())
+          wake.wait_for(lock, std::chrono::milliseconds(1));
+      }
+      sleeping.fetch_sub(1, std::memory_order_acq_rel);
+      idle = 0;
+    }
+  }
+}
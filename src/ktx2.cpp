@@ -0,0 +1,261 @@
+#include "ktx2.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+const uint8_t IDENTIFIER[12] = {0xAB, 'K',  'T',  'X',  ' ',  '2',
+                                '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+const size_t HEADER_BYTES = 80;
+const size_t LEVEL_INDEX_BYTES = 24;
+const char *const ORIENTATION_KEY = "KTXorientation";
+
+// Khronos data format descriptor values
+const uint8_t MODEL_BC1A = 128;
+const uint8_t MODEL_BC3 = 130;
+const uint8_t MODEL_BC7 = 134;
+const uint8_t MODEL_ETC2 = 161;
+const uint8_t CHANNEL_ALPHA = 15;
+const uint8_t CHANNEL_ETC2_COLOR = 2;
+const uint8_t PRIMARIES_BT709 = 1;
+const uint8_t TRANSFER_LINEAR = 1;
+
+void put32(std::vector<uint8_t> &out, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    out.push_back((uint8_t)(value >> (i * 8)));
+}
+
+void put64(std::vector<uint8_t> &out, uint64_t value) {
+  put32(out, (uint32_t)value);
+  put32(out, (uint32_t)(value >> 32));
+}
+
+uint32_t get32(const uint8_t *in) {
+  return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 |
+         (uint32_t)in[3] << 24;
+}
+
+uint64_t get64(const uint8_t *in) {
+  return (uint64_t)get32(in) | (uint64_t)get32(in + 4) << 32;
+}
+
+void padTo(std::vector<uint8_t> &out, size_t alignment) {
+  while (out.size() % alignment)
+    out.push_back(0);
+}
+
+// one sample per 64 bit half of the block, alpha first where there is one
+void putSample(std::vector<uint8_t> &out, uint16_t bitOffset,
+               uint8_t bitLength, uint8_t channel) {
+  out.push_back((uint8_t)bitOffset);
+  out.push_back((uint8_t)(bitOffset >> 8));
+  out.push_back((uint8_t)(bitLength - 1));
+  out.push_back(channel);
+  put32(out, 0); // sample position
+  put32(out, 0);
+  put32(out, 0xffffffffu);
+}
+
+std::vector<uint8_t> dataFormatDescriptor(BlockFormat format) {
+  uint8_t model = MODEL_BC1A;
+  std::vector<uint8_t> samples;
+  switch (format) {
+  case BlockFormat::Bc1:
+    putSample(samples, 0, 64, 0);
+    break;
+  case BlockFormat::Bc3:
+    model = MODEL_BC3;
+    putSample(samples, 0, 64, CHANNEL_ALPHA);
+    putSample(samples, 64, 64, 0);
+    break;
+  case BlockFormat::Bc7:
+    model = MODEL_BC7;
+    putSample(samples, 0, 128, 0);
+    break;
+  case BlockFormat::Etc2Rgb:
+    model = MODEL_ETC2;
+    putSample(samples, 0, 64, CHANNEL_ETC2_COLOR);
+    break;
+  case BlockFormat::Etc2Rgba:
+    model = MODEL_ETC2;
+    putSample(samples, 0, 64, CHANNEL_ALPHA);
+    putSample(samples, 64, 64, CHANNEL_ETC2_COLOR);
+    break;
+  }
+
+  std::vector<uint8_t> block;
+  const uint32_t blockSize = 24 + (uint32_t)samples.size();
+  put32(block, 4 + blockSize); // dfdTotalSize
+  put32(block, 0);             // Khronos vendor, basic descriptor type
+  put32(block, 2 | blockSize << 16);
+  block.push_back(model);
+  block.push_back(PRIMARIES_BT709);
+  block.push_back(TRANSFER_LINEAR);
+  block.push_back(0); // straight alpha
+  // 4x4x1 texel blocks, dimensions are stored minus one
+  const uint8_t dimensions[4] = {3, 3, 0, 0};
+  block.insert(block.end(), dimensions, dimensions + 4);
+  block.push_back((uint8_t)blockBytes(format));
+  block.insert(block.end(), 7, 0);
+  block.insert(block.end(), samples.begin(), samples.end());
+  return block;
+}
+
+bool fail(const std::string &path, const char *what) {
+  std::cout << "ERROR::KTX2::" << what << "\n" << path << std::endl;
+  return false;
+}
+
+} // namespace
+
+bool writeKtx2(const std::string &path, const Ktx2Texture &texture) {
+  const uint32_t levelCount = (uint32_t)texture.levels.size();
+  const size_t alignment = std::max<size_t>(4, blockBytes(texture.format));
+
+  std::vector<uint8_t> dfd = dataFormatDescriptor(texture.format);
+  std::vector<uint8_t> kvd;
+  std::string orientation = texture.orientation;
+  put32(kvd, (uint32_t)(std::strlen(ORIENTATION_KEY) + 1 +
+                        orientation.size() + 1));
+  kvd.insert(kvd.end(), ORIENTATION_KEY,
+             ORIENTATION_KEY + std::strlen(ORIENTATION_KEY) + 1);
+  kvd.insert(kvd.end(), orientation.c_str(),
+             orientation.c_str() + orientation.size() + 1);
+  padTo(kvd, 4);
+
+  const size_t dfdOffset = HEADER_BYTES + levelCount * LEVEL_INDEX_BYTES;
+  const size_t kvdOffset = dfdOffset + dfd.size();
+
+  // smallest level first, each aligned to the block size
+  std::vector<uint8_t> data;
+  std::vector<uint64_t> offsets(levelCount);
+  size_t dataStart = kvdOffset + kvd.size();
+  for (uint32_t level = levelCount; level-- > 0;) {
+    while ((dataStart + data.size()) % alignment)
+      data.push_back(0);
+    offsets[level] = dataStart + data.size();
+    data.insert(data.end(), texture.levels[level].begin(),
+                texture.levels[level].end());
+  }
+
+  std::vector<uint8_t> out(IDENTIFIER, IDENTIFIER + sizeof(IDENTIFIER));
+  put32(out, blockVkFormat(texture.format));
+  put32(out, 1); // typeSize
+  put32(out, texture.width);
+  put32(out, texture.height);
+  put32(out, 0); // pixelDepth
+  put32(out, 0); // layerCount
+  put32(out, 1); // faceCount
+  put32(out, levelCount);
+  put32(out, 0); // no supercompression
+  put32(out, (uint32_t)dfdOffset);
+  put32(out, (uint32_t)dfd.size());
+  put32(out, (uint32_t)kvdOffset);
+  put32(out, (uint32_t)kvd.size());
+  put64(out, 0); // no supercompression global data
+  put64(out, 0);
+  for (uint32_t level = 0; level < levelCount; level++) {
+    put64(out, offsets[level]);
+    put64(out, texture.levels[level].size());
+    put64(out, texture.levels[level].size());
+  }
+  out.insert(out.end(), dfd.begin(), dfd.end());
+  out.insert(out.end(), kvd.begin(), kvd.end());
+  out.insert(out.end(), data.begin(), data.end());
+
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char *)out.data(), (std::streamsize)out.size());
+  return file ? true : fail(path, "WRITE_FAILED");
+}
+
+bool readKtx2(const std::string &path, Ktx2Texture &texture) {
+  std::vector<uint8_t> bytes;
+  Ktx2View view;
+  if (!readKtx2(path, bytes, view))
+    return false;
+  texture.format = view.format;
+  texture.width = view.width;
+  texture.height = view.height;
+  texture.orientation = view.orientation;
+  texture.levels.clear();
+  for (const Ktx2Level &level : view.levels)
+    texture.levels.emplace_back(level.data, level.data + level.size);
+  return true;
+}
+
+bool readKtx2(const std::string &path, std::vector<uint8_t> &bytes,
+              Ktx2View &view) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return fail(path, "OPEN_FAILED");
+  bytes.assign(std::istreambuf_iterator<char>(file),
+               std::istreambuf_iterator<char>());
+  return parseKtx2(bytes.data(), bytes.size(), path, view);
+}
+
+bool parseKtx2(const uint8_t *in, size_t size, const std::string &path,
+               Ktx2View &texture) {
+  if (size < HEADER_BYTES ||
+      std::memcmp(in, IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+    return fail(path, "NOT_KTX2");
+  const uint8_t *header = in + sizeof(IDENTIFIER);
+  if (!blockFormatFromVk(get32(header), texture.format))
+    return fail(path, "UNSUPPORTED_FORMAT");
+  texture.width = get32(header + 8);
+  texture.height = get32(header + 12);
+  uint32_t layers = get32(header + 20);
+  uint32_t faces = get32(header + 24);
+  uint32_t levelCount = std::max(1u, get32(header + 28));
+  uint32_t supercompression = get32(header + 32);
+  if (get32(header + 16) > 1 || layers > 1 || faces != 1 ||
+      supercompression != 0)
+    return fail(path, "UNSUPPORTED_LAYOUT");
+  // a full chain ends at 1x1, which also keeps every level's shift below 32
+  uint32_t maxLevels = 1;
+  for (uint32_t extent = std::max(texture.width, texture.height); extent > 1;
+       extent >>= 1)
+    maxLevels++;
+  if (texture.width == 0 || texture.height == 0 || levelCount > maxLevels)
+    return fail(path, "BAD_SIZE");
+  if (HEADER_BYTES + (size_t)levelCount * LEVEL_INDEX_BYTES > size)
+    return fail(path, "TRUNCATED");
+
+  texture.orientation = "rd";
+  uint32_t kvdOffset = get32(header + 44);
+  uint32_t kvdLength = get32(header + 48);
+  if ((size_t)kvdOffset + kvdLength <= size) {
+    const uint8_t *entry = in + kvdOffset;
+    const uint8_t *end = entry + kvdLength;
+    while (end - entry >= 4) {
+      uint32_t length = get32(entry);
+      const char *key = (const char *)entry + 4;
+      if (length > (size_t)(end - entry - 4))
+        break;
+      size_t keyLength = strnlen(key, length);
+      if (keyLength < length && std::strcmp(key, ORIENTATION_KEY) == 0)
+        texture.orientation.assign(key + keyLength + 1,
+                                   strnlen(key + keyLength + 1,
+                                           length - keyLength - 1));
+      entry += 4 + ((length + 3) & ~3u);
+    }
+  }
+
+  texture.levels.assign(levelCount, Ktx2Level());
+  for (uint32_t level = 0; level < levelCount; level++) {
+    const uint8_t *index = in + HEADER_BYTES + level * LEVEL_INDEX_BYTES;
+    uint64_t offset = get64(index), length = get64(index + 8);
+    uint32_t width = std::max(1u, texture.width >> level);
+    uint32_t height = std::max(1u, texture.height >> level);
+    // offset + length could wrap, so neither is trusted before the other
+    if (offset > size || length > size - offset ||
+        length != compressedSize(texture.format, width, height))
+      return fail(path, "BAD_LEVEL");
+    texture.levels[level].data = in + offset;
+    texture.levels[level].size = (size_t)length;
+  }
+  return true;
+}
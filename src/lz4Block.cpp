@@ -0,0 +1,151 @@
+#include "lz4Block.h"
+
+#include <cstring>
+
+namespace {
+
+const unsigned int HASH_BITS = 12;
+const size_t MIN_MATCH = 4;
+// the format wants the last 5 bytes as literals and no match starting in
+// the last 12
+const size_t LAST_LITERALS = 5;
+const size_t MATCH_FIND_LIMIT = 12;
+const size_t MAX_OFFSET = 65535;
+
+uint32_t read32(const uint8_t *p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void putLength(std::vector<uint8_t> &out, size_t length) {
+  for (; length >= 255; length -= 255)
+    out.push_back(255);
+  out.push_back((uint8_t)length);
+}
+
+void putSequence(std::vector<uint8_t> &out, const uint8_t *literals,
+                 size_t literalCount, size_t offset, size_t matchLength) {
+  size_t extraMatch = matchLength >= MIN_MATCH ? matchLength - MIN_MATCH : 0;
+  uint8_t token = (uint8_t)((literalCount < 15 ? literalCount : 15) << 4);
+  if (offset)
+    token |= (uint8_t)(extraMatch < 15 ? extraMatch : 15);
+  out.push_back(token);
+  if (literalCount >= 15)
+    putLength(out, literalCount - 15);
+  out.insert(out.end(), literals, literals + literalCount);
+
+  // the last sequence is literals only
+  if (!offset)
+    return;
+  out.push_back((uint8_t)offset);
+  out.push_back((uint8_t)(offset >> 8));
+  if (extraMatch >= 15)
+    putLength(out, extraMatch - 15);
+}
+
+} // namespace
+
+size_t lz4Compress(const uint8_t *source, size_t size,
+                   std::vector<uint8_t> &out) {
+  const size_t start = out.size();
+  size_t anchor = 0;
+
+  if (size > MATCH_FIND_LIMIT) {
+    // positions plus one, zero is empty
+    std::vector<uint32_t> table(1u << HASH_BITS, 0);
+    const size_t findLimit = size - MATCH_FIND_LIMIT;
+    const size_t matchLimit = size - LAST_LITERALS;
+
+    size_t position = 0;
+    while (position < findLimit) {
+      uint32_t sequence = read32(source + position);
+      uint32_t &slot = table[hash(sequence)];
+      size_t candidate = slot;
+      slot = (uint32_t)position + 1;
+      if (!candidate || position - (candidate - 1) > MAX_OFFSET ||
+          read32(source + candidate - 1) != sequence) {
+        position++;
+        continue;
+      }
+      candidate--;
+
+      size_t length = MIN_MATCH;
+      while (position + length < matchLimit &&
+             source[candidate + length] == source[position + length])
+        length++;
+
+      putSequence(out, source + anchor, position - anchor,
+                  position - candidate, length);
+      position += length;
+      anchor = position;
+    }
+  }
+
+  putSequence(out, source + anchor, size - anchor, 0, 0);
+  return out.size() - start;
+}
+
+bool lz4Decompress(const uint8_t *source, size_t size, uint8_t *out,
+                   size_t outSize) {
+  const uint8_t *in = source;
+  const uint8_t *inEnd = source + size;
+  uint8_t *op = out;
+  uint8_t *outEnd = out + outSize;
+
+  while (in < inEnd) {
+    uint8_t token = *in++;
+
+    size_t literals = token >> 4;
+    if (literals == 15) {
+      uint8_t more;
+      do {
+        if (in >= inEnd)
+          return false;
+        more = *in++;
+        literals += more;
+      } while (more == 255);
+    }
+    if (literals > (size_t)(inEnd - in) || literals > (size_t)(outEnd - op))
+      return false;
+    std::memcpy(op, in, literals);
+    in += literals;
+    op += literals;
+
+    // the last sequence ends after its literals
+    if (in == inEnd)
+      break;
+
+    if (inEnd - in < 2)
+      return false;
+    size_t offset = in[0] | (size_t)in[1] << 8;
+    in += 2;
+    if (offset == 0 || offset > (size_t)(op - out))
+      return false;
+
+    size_t length = token & 15;
+    if (length == 15) {
+      uint8_t more;
+      do {
+        if (in >= inEnd)
+          return false;
+        more = *in++;
+        length += more;
+      } while (more == 255);
+    }
+    length += MIN_MATCH;
+    if (length > (size_t)(outEnd - op))
+      return false;
+
+    // byte by byte, the match may overlap what it is writing
+    const uint8_t *match = op - offset;
+    for (size_t i = 0; i < length; i++)
+      op[i] = match[i];
+    op += length;
+  }
+  return op == outEnd;
+}
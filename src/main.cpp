@@ -1,6 +1,32 @@
+#include "allocationCounter.h"
+#include "assetPack.h"
+#include "benchmarks.h"
+#include "bvh.h"
+#include "errorReporting.h"
+#include "frameArena.h"
+#include "frameStats.h"
+#include "frameUniforms.h"
+#include "frustumCulling.h"
+#include "glExtensions.h"
+#include "glState.h"
 #include "glad/glad.h"
+#include "gpuCuller.h"
+#include "gpuTimer.h"
+#include "instancedRenderer.h"
+#include "jobSystem.h"
+#include "meshBatch.h"
+#include "meshBuilder.h"
+#include "offscreenTarget.h"
+#include "programCache.h"
+#include "renderQueue.h"
 #include "shader.h"
-#include "stb_image.h"
+#include "shaderCompiler.h"
+#include "shaderPreprocessor.h"
+#include "shaderVariants.h"
+#include "shaderWatcher.h"
+#include "streamBuffer.h"
+#include "textureLoader.h"
+#include "transformStore.h"
 #include <GLFW/glfw3.h>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/geometric.hpp>
@@ -8,10 +34,20 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/trigonometric.hpp>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
 const auto WIN_WIDTH = 800;
 const auto WIN_HEIGHT = 600;
 const auto WIN_TITLE = "OpenGL Yey!!";
+const size_t TEXTURE_UPLOAD_BUDGET = 8 * 1024 * 1024;
+// frames before heap allocations should have stopped, containers have
+// grown to their working size by then
+const unsigned int WARMUP_FRAMES = 10;
 
 glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
@@ -26,6 +62,40 @@ bool firstMouse = true;
 float Zoom = 0.0f;
 float fov = 45.0f;
 
+struct Options {
+  unsigned int cubeCount = 10;
+  // render into an FBO of an invisible window for a fixed number of frames
+  bool headless = false;
+  unsigned int frames = 600;
+  // frame statistics written at exit and on F2, .json or .csv; the GPU
+  // pass summary is printed alongside
+  std::string statsPath;
+  // report GL debug messages on the calling thread instead of the driver's
+  bool syncDebugOutput = false;
+  // frustum cull the cubes every frame and draw only the visible ones
+  bool cull = false;
+  // cull through the BVH instead of testing every cube
+  bool cullWithBvh = false;
+  // cull in a compute pass that writes the indirect draw, falls back to the
+  // CPU without compute shaders
+  bool gpuCull = false;
+  // assets are read from this pack when it exists, loose files otherwise
+  std::string packPath = "assets.pack";
+  // rebuild shaders when their loose source files are saved
+  bool hotReload = false;
+  // run a CPU benchmark instead of the scene
+  const char *benchmark = nullptr;
+  unsigned int benchmarkCount = 0;
+};
+
+// set from the input callbacks, handled at the end of the frame
+bool dumpStatsRequested = false;
+bool pickRequested = false;
+bool decalToggleRequested = false;
+
+// option bits of the cube shader variants
+const uint32_t CUBE_DECAL = 1;
+
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
@@ -36,19 +106,92 @@ void changeOpacity(GLFWwindow *window, Shader shader);
 
 void processInput(GLFWwindow *window, Shader *shader);
 
-int main() {
+std::vector<glm::vec3> makeCubePositions(unsigned int count);
+
+// false when the scene could not be set up or a headless run failed its
+// allocation check
+bool runScene(GLFWwindow *window, const Options &options);
+
+const char *shaderModeName(ShaderCompiler::Mode mode);
+
+void printShaderTiming(const ShaderCompiler::Timing &timing);
+
+void selectCubeShader(Shader &shader, RenderQueue &renderQueue,
+                      unsigned int cubeProgram);
+
+void dumpFrameStats(const FrameStats &stats, const GpuTimer &gpuTimer,
+                    const Options &options);
+
+void key_callback(GLFWwindow *window, int key, int scancode, int action,
+                  int mods);
+
+void mouse_button_callback(GLFWwindow *window, int button, int action,
+                           int mods);
+
+int main(int argc, char **argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--cubes") == 0 && i + 1 < argc) {
+      options.cubeCount = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+    } else if (std::strcmp(argv[i], "--headless") == 0) {
+      options.headless = true;
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      options.frames = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+    } else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+      options.statsPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--cull") == 0) {
+      options.cull = true;
+    } else if (std::strcmp(argv[i], "--bvh") == 0) {
+      options.cull = true;
+      options.cullWithBvh = true;
+    } else if (std::strcmp(argv[i], "--gpu-cull") == 0) {
+      options.gpuCull = true;
+    } else if (std::strcmp(argv[i], "--pack") == 0 && i + 1 < argc) {
+      options.packPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--hot-reload") == 0) {
+      options.hotReload = true;
+    } else if (std::strcmp(argv[i], "--sync-debug") == 0) {
+      options.syncDebugOutput = true;
+    } else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+      options.benchmark = argv[++i];
+    } else if (std::strcmp(argv[i], "--bench-count") == 0 && i + 1 < argc) {
+      options.benchmarkCount = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+    } else {
+      std::cerr << "Unknown option " << argv[i] << std::endl;
+      std::cerr << "Usage: " << argv[0]
+                << " [--cubes N] [--cull] [--bvh] [--gpu-cull] [--headless]"
+                << " [--frames N] [--stats FILE] [--pack FILE] [--hot-reload]"
+                << " [--sync-debug]"
+                << " [--bench NAME [--bench-count N]]"
+                << std::endl;
+      listBenchmarks();
+      return -1;
+    }
+  }
+
+  if (options.benchmark)
+    return runBenchmark(options.benchmark, options.benchmarkCount);
 
   glfwInit(); // Do this first always
 
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#if GL_ERROR_REPORTING
+  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+  if (options.headless) {
+    // the window only provides the context, frames go to an FBO
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  }
 
   auto window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, WIN_TITLE, NULL, NULL);
 
   if (!window) {
     std::cerr << "Failed to create window" << std::endl;
     glfwTerminate();
+    return -1;
   }
 
   glfwMakeContextCurrent(window);
@@ -58,17 +201,56 @@ int main() {
     glfwTerminate();
     return -1;
   }
-  glfwSetFramebufferSizeCallback(
-      window, (GLFWframebuffersizefun)frame_buffer_size_callback);
-  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, mouse_callback);
-  glfwSetScrollCallback(window, scroll_callback);
+  loadGlExtensions((GLADloadproc)glfwGetProcAddress);
+  createErrorFile();
+  enableReportGlErrors(options.syncDebugOutput);
+  if (options.headless) {
+    // never wait for a display refresh
+    glfwSwapInterval(0);
+  } else {
+    glfwSetFramebufferSizeCallback(
+        window, (GLFWframebuffersizefun)frame_buffer_size_callback);
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
+  }
 
   glViewport(0, 0, WIN_WIDTH, WIN_HEIGHT);
 
-  Shader shader("vertex.glsl", "fragment.glsl");
+  // everything holding GL objects lives in runScene so it is released
+  // while the context still exists
+  bool passed = runScene(window, options);
+
+  closeErrorFile();
+  glfwTerminate();
+  return passed ? 0 : -1;
+}
 
-  float vertices[] = {
+bool runScene(GLFWwindow *window, const Options &options) {
+  // one mapping instead of opening every asset on its own
+  if (!options.packPath.empty() && assetPack().open(options.packPath))
+    std::cout << "Assets from " << options.packPath << " ("
+              << assetPack().entryCount() << " entries)" << std::endl;
+  // edits are made in the source tree, not to the packed or copied shaders
+  if (options.hotReload)
+    shaderPreprocessor().setSourceDirectory(SHADER_SOURCE_DIR);
+
+  // every program is handed over here and compiles while the assets load
+  ProgramCache programCache("shader_cache");
+  ShaderCompiler shaderCompiler(window, &programCache);
+  // the decal is a compile time option, F3 switches between the variants
+  ShaderVariants cubeShaders("vertex.glsl", "fragment.glsl", {"DECAL"},
+                             shaderCompiler);
+  uint32_t cubeVariant = CUBE_DECAL;
+  // the variant drawn, and the one F3 asked for; the second takes over
+  // once the compiler has adopted it, so input and the watcher never see a
+  // program that is not built
+  Shader *cubeShader = &cubeShaders.get(cubeVariant);
+  Shader *requestedCubeShader = cubeShader;
+
+  std::vector<float> vertices = {
       -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.5f,  -0.5f, -0.5f, 1.0f, 0.0f,
       0.5f,  0.5f,  -0.5f, 1.0f, 1.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f,
       -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f, -0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
@@ -92,81 +274,29 @@ int main() {
       -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f,
       0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
       -0.5f, 0.5f,  0.5f,  0.0f, 0.0f, -0.5f, 0.5f,  -0.5f, 0.0f, 1.0f};
-  int indices[] = {
-      0, 1, 2, // first triangle
-      0, 3, 2  // second triangle
-  };
-  unsigned int texture1;
-  glGenTextures(1, &texture1);
-  glBindTexture(GL_TEXTURE_2D, texture1);
-
-  // Texture Parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                  GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  int width, height, nrChannels;
-
-  auto data1 =
-      (const char *)stbi_load("container.jpg", &width, &height, &nrChannels, 0);
-
-  if (data1) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-                 GL_UNSIGNED_BYTE, data1);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  } else {
-    std::cout << "Failed to load texture1" << std::endl;
-  }
-
-  unsigned int texture2;
-  glGenTextures(1, &texture2);
-  glBindTexture(GL_TEXTURE_2D, texture2);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                  GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  int width2, height2, nrChannels2;
-  stbi_set_flip_vertically_on_load(true);
-
-  auto data2 = (const char *)stbi_load("awesomeface.png", &width2, &height2,
-                                       &nrChannels2, 0);
-
-  if (data2) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width2, height2, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, data2);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  } else {
-
-    std::cout << "Failed to load texture2" << std::endl;
-  }
-
-  std::cout << data2 << std::endl;
-  // stbi_image_free(data);
-
-  unsigned int VBO, VAO, EBO;
-  glGenVertexArrays(1, &VAO);
-  glBindVertexArray(VAO);
-
-  glGenBuffers(1, &VBO);
-  glGenBuffers(1, &EBO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
-               GL_STATIC_DRAW);
-
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
-                        (void *)(3 * sizeof(float)));
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
+  // welded and reordered for the post transform cache
+  MeshBuildStats cubeBuild;
+  IndexedMesh cube =
+      buildIndexedMesh(vertices, MeshBatch::VERTEX_FLOATS, &cubeBuild);
+  std::cout << "Cube mesh: " << cubeBuild.inputVertices << " -> "
+            << cubeBuild.outputVertices << " vertices, "
+            << cube.indices.size() << " indices, ACMR "
+            << cubeBuild.acmrBefore << " -> " << cubeBuild.acmrAfter
+            << std::endl;
+
+  // decoded in the background, both show a placeholder until uploaded
+  TextureLoader textureLoader;
+  unsigned int texture1 = textureLoader.load("container.jpg");
+  unsigned int texture2 = textureLoader.load("awesomeface.png", true);
+
+  // every mesh lives in the batch's shared vertex and index buffers
+  MeshBatch meshBatch;
+  const unsigned int cubeMesh = meshBatch.addMesh(cube.vertices, cube.indices);
+  meshBatch.upload();
+  std::cout << "Drawing with "
+            << (meshBatch.indirect() ? "glMultiDrawElementsIndirect"
+                                     : "glDrawElementsInstancedBaseVertex")
+            << std::endl;
 
   // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
   // int nrAttributes;
@@ -174,66 +304,393 @@ int main() {
   // std::cout << "Maximum nr of vertex attributes supported: " << nrAttributes
   //           << std::endl;
   //
-  shader.use();
-  shader.setInt("texture1", 0);
-  shader.setInt("texture2", 1);
 
-  glEnable(GL_DEPTH_TEST);
+  // camera data for every program, uploaded once per frame
+  FrameUniforms frameUniforms;
+  FrameData frameData;
+  float projectionFov = -1.0f;
+
+  glState().enable(GL_DEPTH_TEST);
+
+  // every cube shares the same spin, so the per instance matrices are plain
+  // translations and the spin goes through the model uniform. The store
+  // only recomputes and reuploads them when a cube moves
+  JobSystem jobs;
+  std::vector<glm::vec3> cubePositions = makeCubePositions(options.cubeCount);
+  TransformStore cubeTransforms;
+  for (const glm::vec3 &position : cubePositions)
+    cubeTransforms.add(position);
+  cubeTransforms.update(&jobs);
+  const std::vector<glm::mat4> &cubeModels = cubeTransforms.worldMatrices();
+
+  InstancedRenderer cubes(meshBatch.vertexArray(), cubeModels);
+
+  // a sphere around the unit cube covers it at any spin, the BVH uses the
+  // box around that sphere
+  const float cubeRadius = 0.8660254f;
+  SphereSet cubeBounds;
+  std::vector<glm::vec3> cubeMins, cubeMaxs;
+  for (const glm::vec3 &position : cubePositions) {
+    cubeBounds.add(position, cubeRadius);
+    cubeMins.push_back(position - glm::vec3(cubeRadius));
+    cubeMaxs.push_back(position + glm::vec3(cubeRadius));
+  }
+  Bvh cubeBvh;
+  cubeBvh.build(cubeMins, cubeMaxs);
+  std::vector<uint32_t> visibleCubes;
+
+  // the compute pass keeps every instance on the GPU and draws the
+  // survivors through one indirect command
+  std::unique_ptr<GpuCuller> gpuCuller;
+  if (options.gpuCull && GpuCuller::supported()) {
+    gpuCuller.reset(new GpuCuller(shaderCompiler));
+    gpuCuller->setInstances(cubeBounds, cubeModels);
+    cubes.attach(gpuCuller->visibleBuffer(), 0, gpuCuller->instanceCount());
+    std::cout << "Frustum culling in a compute pass" << std::endl;
+  } else if (options.gpuCull) {
+    std::cout << "No compute shaders, culling on the CPU" << std::endl;
+  }
+  const bool cpuCull = !gpuCuller && (options.cull || options.gpuCull);
+
+  // visible matrices are written straight into GL memory each frame
+  std::unique_ptr<StreamBuffer> instanceStream;
+  if (cpuCull) {
+    instanceStream.reset(new StreamBuffer(
+        GL_ARRAY_BUFFER, cubeModels.size() * sizeof(glm::mat4)));
+    std::cout << "Frustum culling with "
+              << (options.cullWithBvh ? "bvh" : cullPathName(CullPath::Best))
+              << ", instances through "
+              << (instanceStream->persistent() ? "a persistent mapping"
+                                               : "glBufferSubData")
+              << std::endl;
+  }
 
-  glm::vec3 cubePositions[] = {
-      glm::vec3(0.0f, 0.0f, 0.0f),    glm::vec3(2.0f, 5.0f, -15.0f),
-      glm::vec3(-1.5f, -2.2f, -2.5f), glm::vec3(-3.8f, -2.0f, -12.3f),
-      glm::vec3(2.4f, -0.4f, -3.5f),  glm::vec3(-1.7f, 3.0f, -7.5f),
-      glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),
-      glm::vec3(1.5f, 0.2f, -1.5f),   glm::vec3(-1.3f, 1.0f, -1.5f),
-  };
+  // the first use of the programs
+  shaderCompiler.finish();
+  std::cout << "Shaders built "
+            << shaderModeName(shaderCompiler.mode()) << std::endl;
+  for (const ShaderCompiler::Timing &timing : shaderCompiler.timings())
+    printShaderTiming(timing);
+  if (gpuCuller)
+    gpuCuller->programChanged();
+
+  RenderQueue renderQueue;
+  const unsigned int cubeProgram = renderQueue.addProgram(*cubeShader);
+  selectCubeShader(*cubeShader, renderQueue, cubeProgram);
+
+  std::unique_ptr<ShaderWatcher> shaderWatcher;
+  if (options.hotReload) {
+    shaderWatcher.reset(new ShaderWatcher(shaderCompiler));
+    shaderWatcher->add(*cubeShader);
+    if (gpuCuller)
+      shaderWatcher->add(gpuCuller->shader());
+    if (shaderWatcher->available())
+      std::cout << "Watching shader sources" << std::endl;
+    else
+      std::cout << "No inotify, shader hot reload is off" << std::endl;
+  }
+  const unsigned int cubeTextures =
+      renderQueue.addTextureSet({texture1, texture2});
+  const unsigned int cubeBatch = renderQueue.addBatch(meshBatch, cubes);
+
+  std::unique_ptr<OffscreenTarget> offscreen;
+  if (options.headless) {
+    offscreen.reset(new OffscreenTarget(WIN_WIDTH, WIN_HEIGHT));
+    if (!offscreen->complete())
+      return false;
+    offscreen->bind();
+    // decode everything up front so every measured frame is the same work
+    textureLoader.finish();
+  }
 
-  while (!glfwWindowShouldClose(window)) {
-    processInput(window, &shader);
+  FrameStats stats;
+  const unsigned int inputPhase = stats.addPhase("input");
+  const unsigned int uploadPhase = stats.addPhase("upload");
+  const unsigned int cullPhase = stats.addPhase("cull");
+  const unsigned int renderPhase = stats.addPhase("render");
+  const unsigned int cpuPhase = stats.addPhase("cpu");
+  const unsigned int swapPhase = stats.addPhase("swap");
+
+  GpuTimer gpuTimer;
+  const unsigned int clearPass = gpuTimer.addPass("clear");
+  const unsigned int cubePass = gpuTimer.addPass("cubes");
+
+  // transient per frame data, recycled once the frames using it are done
+  FrameArena frameArena;
+
+  // headless mode keeps at most two frames in flight
+  GLsync frameFences[2] = {NULL, NULL};
+  uint64_t steadyAllocations = 0;
+  double runStart = glfwGetTime();
+  unsigned int frame = 0;
+
+  while (options.headless ? frame < options.frames
+                          : !glfwWindowShouldClose(window)) {
+    stats.beginFrame();
+    gpuTimer.beginFrame();
+    glState().beginFrame();
+    if (!options.headless)
+      processInput(window, cubeShader);
+
+    // rebuilt programs only replace the old ones here, between frames
+    if (shaderWatcher)
+      shaderWatcher->update();
+    if (shaderCompiler.update()) {
+      printShaderTiming(shaderCompiler.timings().back());
+      if (requestedCubeShader != cubeShader && requestedCubeShader->ready()) {
+        cubeShader = requestedCubeShader;
+        if (shaderWatcher)
+          shaderWatcher->add(*cubeShader);
+      }
+      if (cubeShader->ready())
+        selectCubeShader(*cubeShader, renderQueue, cubeProgram);
+      if (gpuCuller)
+        gpuCuller->programChanged();
+    }
 
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
-    // rendering
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 
-    shader.use();
+    stats.lap(inputPhase);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture2);
+    // bounded so a burst of finished images cannot stall one frame
+    textureLoader.update(TEXTURE_UPLOAD_BUDGET);
+    stats.lap(uploadPhase);
 
-    glBindVertexArray(VAO);
+    frameData.view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    // the projection only changes when scrolling zooms
+    if (fov != projectionFov) {
+      projectionFov = fov;
+      frameData.projection =
+          glm::perspective(glm::radians(fov), 800.0f / 600.0f, 0.1f, 100.0f);
+    }
+    frameData.viewProjection = frameData.projection * frameData.view;
+    frameData.cameraPosition = glm::vec4(cameraPos, 1.0f);
+    frameData.time = currentFrame;
+
+    size_t movedCubes = cubeTransforms.update(&jobs);
+    if (movedCubes > 0 && gpuCuller)
+      gpuCuller->updateModels(cubeModels);
+    else if (movedCubes > 0 && !cpuCull)
+      cubes.update(cubeModels);
+
+    // only the visible instances are uploaded and drawn
+    if (gpuCuller) {
+      gpuCuller->cull(extractFrustum(frameData.viewProjection),
+                      meshBatch.mesh(cubeMesh));
+    } else if (cpuCull) {
+      Frustum frustum = extractFrustum(frameData.viewProjection);
+      if (options.cullWithBvh) {
+        visibleCubes.clear();
+        cubeBvh.cull(frustum, visibleCubes);
+      } else {
+        cullSpheres(frustum, cubeBounds, visibleCubes);
+      }
+      instanceStream->beginFrame();
+      size_t offset = 0;
+      glm::mat4 *visibleModels = (glm::mat4 *)instanceStream->allocate(
+          visibleCubes.size() * sizeof(glm::mat4), sizeof(glm::vec4), offset);
+      // the region holds every cube, the arena only covers a failure
+      bool streamed = visibleModels != nullptr;
+      if (!streamed)
+        visibleModels =
+            frameArena.allocateArray<glm::mat4>(visibleCubes.size());
+      for (size_t i = 0; i < visibleCubes.size(); i++)
+        visibleModels[i] = cubeModels[visibleCubes[i]];
+
+      unsigned int visibleCount = (unsigned int)visibleCubes.size();
+      if (streamed) {
+        instanceStream->flush();
+        cubes.attach(instanceStream->buffer(), offset, visibleCount);
+      } else {
+        cubes.update(visibleModels, visibleCount);
+      }
+    }
+    stats.lap(cullPhase);
 
-    glm::mat4 view = glm::mat4(1.0f);
-    view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    // rendering
+    frameUniforms.update(frameData);
 
-    glm::mat4 projection;
-    projection =
-        glm::perspective(glm::radians(fov), 800.0f / 600.0f, 0.1f, 100.0f);
+    gpuTimer.begin(clearPass);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    gpuTimer.end(clearPass);
+
+    gpuTimer.begin(cubePass);
+
+    glm::mat4 model(1.0f);
+    model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f),
+                        glm::vec3(1.0f, 0.3f, 0.5f));
+
+    meshBatch.clear();
+    if (gpuCuller)
+      meshBatch.drawFrom(gpuCuller->commandBuffer(), 1);
+    else
+      meshBatch.add(cubeMesh, cubes.instanceCount(), 0);
+
+    renderQueue.clear();
+    renderQueue.submitBatch(0, cubeProgram, cubeTextures, cubeBatch, 0.0f,
+                            GL_TRIANGLES, model);
+    renderQueue.sort();
+    renderQueue.execute();
+    if (instanceStream)
+      instanceStream->endFrame();
+    gpuTimer.end(cubePass);
+    stats.lap(renderPhase);
+    stats.addTime(cpuPhase, stats.sinceFrameStart());
+
+    // in headless mode waiting on the fence stands in for the swap
+    if (options.headless) {
+      GLsync &fence = frameFences[frame % 2];
+      if (fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+      }
+      fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    } else {
+      glfwSwapBuffers(window);
+    }
+    frameArena.nextFrame();
+    stats.lap(swapPhase);
 
-    shader.setMat4("view", view);
-    shader.setMat4("projection", projection);
+    glfwPollEvents();
+    stats.lap(inputPhase);
+    stats.endFrame();
+
+    if (pickRequested) {
+      pickRequested = false;
+      float distance;
+      int picked = cubeBvh.raycast(cameraPos, cameraFront, distance);
+      if (picked >= 0)
+        std::cout << "Picked cube " << picked << " at distance " << distance
+                  << std::endl;
+    }
+    if (decalToggleRequested) {
+      decalToggleRequested = false;
+      cubeVariant ^= CUBE_DECAL;
+      // built on first use, the current variant keeps drawing until the
+      // compiler adopts it
+      requestedCubeShader = &cubeShaders.get(cubeVariant);
+      if (requestedCubeShader->ready()) {
+        cubeShader = requestedCubeShader;
+        if (shaderWatcher)
+          shaderWatcher->add(*cubeShader);
+        selectCubeShader(*cubeShader, renderQueue, cubeProgram);
+      }
+    }
+    if (dumpStatsRequested) {
+      dumpStatsRequested = false;
+      dumpFrameStats(stats, gpuTimer, options);
+    }
+    frame++;
+    if (frame == WARMUP_FRAMES)
+      steadyAllocations = heapAllocations();
+  }
 
-    for (unsigned int i = 0; i < 10; i++) {
-      glm::mat4 model(1.0f);
-      model = glm::translate(model, cubePositions[i]);
+  bool passed = true;
+  if (options.headless) {
+    gpuTimer.finish();
+    double total = glfwGetTime() - runStart;
+    for (GLsync fence : frameFences)
+      if (fence)
+        glDeleteSync(fence);
+    std::cout << "Headless: " << frame << " frames in " << total * 1000.0
+              << " ms (" << frame / total << " fps)" << std::endl;
+    if (!COUNT_ALLOCATIONS) {
+      std::cout << "Heap allocations not counted, configure with "
+                   "-DCOUNT_ALLOCATIONS=ON"
+                << std::endl;
+    } else if (frame > WARMUP_FRAMES) {
+      uint64_t steady = heapAllocations() - steadyAllocations;
+      std::cout << steady << " heap allocations after the first "
+                << WARMUP_FRAMES << " frames" << std::endl;
+      if (steady > 0) {
+        std::cout << "ERROR::HEADLESS::STEADY_STATE_ALLOCATIONS" << std::endl;
+        passed = false;
+      }
+    }
+    std::cout << "Frame arena: " << frameArena.lastFrameBytes()
+              << " bytes last frame, peak " << frameArena.peakFrameBytes()
+              << " of " << frameArena.capacity() << ", "
+              << frameArena.overflowCount() << " overflow allocations"
+              << std::endl;
+    if (instanceStream)
+      std::cout << "Instance stream: " << instanceStream->stats().stalls
+                << " stalls, " << instanceStream->stats().stallMs
+                << " ms waiting on fences" << std::endl;
+  }
+  if (options.headless || !options.statsPath.empty())
+    dumpFrameStats(stats, gpuTimer, options);
+  return passed;
+}
 
-      float angle = 20.0f * i;
-      model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f),
-                          glm::vec3(1.0f, 0.3f, 0.5f));
+void dumpFrameStats(const FrameStats &stats, const GpuTimer &gpuTimer,
+                    const Options &options) {
+  stats.printSummary(std::cout);
+  gpuTimer.printSummary(std::cout);
+
+  const GlState::Counters &last = glState().lastFrame();
+  const GlState::Counters &total = glState().total();
+  std::cout << "GL state calls last frame: " << last.issued << " issued, "
+            << last.elided << " elided (" << total.issued << " / "
+            << total.elided << " overall)" << std::endl;
+  if (!options.statsPath.empty() && !stats.writeFile(options.statsPath))
+    std::cerr << "Failed to write " << options.statsPath << std::endl;
+}
 
-      shader.setMat4("model", model);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
+const char *shaderModeName(ShaderCompiler::Mode mode) {
+  switch (mode) {
+  case ShaderCompiler::Mode::Parallel:
+    return "with GL_KHR_parallel_shader_compile";
+  case ShaderCompiler::Mode::Worker:
+    return "on a shared worker context";
+  case ShaderCompiler::Mode::Blocking:
+    break;
+  }
+  return "on the GL thread";
+}
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+void printShaderTiming(const ShaderCompiler::Timing &timing) {
+  std::cout << "  " << timing.name << ": ";
+  if (timing.cached)
+    std::cout << "cached binary in " << timing.linkMs << " ms";
+  else
+    std::cout << "compile " << timing.compileMs << " ms, link "
+              << timing.linkMs << " ms";
+  std::cout << (timing.linked ? "" : ", failed") << std::endl;
+}
+
+void selectCubeShader(Shader &shader, RenderQueue &renderQueue,
+                      unsigned int cubeProgram) {
+  // sampler units are program state, every variant needs its own
+  shader.use();
+  shader.setInt(shader.uniform("texture1"_u), 0);
+  shader.setInt(shader.uniform("texture2"_u), 1);
+  renderQueue.updateProgram(cubeProgram, shader);
+}
+
+std::vector<glm::vec3> makeCubePositions(unsigned int count) {
+  std::vector<glm::vec3> positions = {
+      glm::vec3(0.0f, 0.0f, 0.0f),    glm::vec3(2.0f, 5.0f, -15.0f),
+      glm::vec3(-1.5f, -2.2f, -2.5f), glm::vec3(-3.8f, -2.0f, -12.3f),
+      glm::vec3(2.4f, -0.4f, -3.5f),  glm::vec3(-1.7f, 3.0f, -7.5f),
+      glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),
+      glm::vec3(1.5f, 0.2f, -1.5f),   glm::vec3(-1.3f, 1.0f, -1.5f),
+  };
+  if (count <= positions.size()) {
+    positions.resize(count);
+    return positions;
   }
 
-  glfwTerminate();
+  // scatter the rest in front of the camera, fixed seed so runs compare
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> spread(-50.0f, 50.0f);
+  std::uniform_real_distribution<float> depth(-95.0f, -5.0f);
+  positions.reserve(count);
+  while (positions.size() < count)
+    positions.push_back(glm::vec3(spread(rng), spread(rng), depth(rng)));
+  return positions;
 }
 
 void frame_buffer_size_callback(GLFWwindow *window, int width, int height) {
@@ -315,6 +772,20 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
   cameraFront = glm::normalize(direction);
 }
 
+void key_callback(GLFWwindow *window, int key, int scancode, int action,
+                  int mods) {
+  if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+    dumpStatsRequested = true;
+  if (key == GLFW_KEY_F3 && action == GLFW_PRESS)
+    decalToggleRequested = true;
+}
+
+void mouse_button_callback(GLFWwindow *window, int button, int action,
+                           int mods) {
+  if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+    pickRequested = true;
+}
+
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
   Zoom -= (float)yoffset;
 
@@ -0,0 +1,111 @@
+#include "meshBatch.h"
+#include "glExtensions.h"
+#include "glState.h"
+#include "instancedRenderer.h"
+
+#include <algorithm>
+
+MeshBatch::MeshBatch() {
+  glGenVertexArrays(1, &VAO);
+  glGenBuffers(1, &VBO);
+  glGenBuffers(1, &EBO);
+  if (indirect())
+    glGenBuffers(1, &indirectBuffer);
+}
+
+MeshBatch::~MeshBatch() {
+  glDeleteVertexArrays(1, &VAO);
+  glDeleteBuffers(1, &VBO);
+  glDeleteBuffers(1, &EBO);
+  if (indirectBuffer)
+    glDeleteBuffers(1, &indirectBuffer);
+  glState().invalidate();
+}
+
+bool MeshBatch::indirect() const { return GLEXT_ARB_multi_draw_indirect; }
+
+unsigned int MeshBatch::addMesh(const std::vector<float> &vertices,
+                                const std::vector<uint32_t> &indices) {
+  // indices stay relative to the mesh, baseVertex offsets them
+  Mesh mesh;
+  mesh.firstIndex = (GLuint)indexData.size();
+  mesh.indexCount = (GLuint)indices.size();
+  mesh.baseVertex = (GLint)(vertexData.size() / VERTEX_FLOATS);
+  meshes.push_back(mesh);
+
+  vertexData.insert(vertexData.end(), vertices.begin(), vertices.end());
+  indexData.insert(indexData.end(), indices.begin(), indices.end());
+  return (unsigned int)meshes.size() - 1;
+}
+
+void MeshBatch::upload() {
+  glState().bindVertexArray(VAO);
+
+  glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float),
+               vertexData.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(uint32_t),
+               indexData.data(), GL_STATIC_DRAW);
+
+  const GLsizei stride = VERTEX_FLOATS * sizeof(float);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride,
+                        (void *)(3 * sizeof(float)));
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+
+  glState().bindVertexArray(0);
+}
+
+void MeshBatch::add(unsigned int mesh, GLuint instanceCount,
+                    GLuint firstInstance) {
+  const Mesh &source = meshes[mesh];
+  commands.push_back(DrawElementsIndirectCommand{
+      source.indexCount, instanceCount, source.firstIndex, source.baseVertex,
+      firstInstance});
+}
+
+void MeshBatch::drawFrom(unsigned int buffer, GLsizei drawCount) {
+  externalCommands = buffer;
+  externalCount = drawCount;
+}
+
+void MeshBatch::draw(GLenum mode, InstancedRenderer &instances) {
+  if (externalCommands) {
+    instances.setFirstInstance(0);
+    glState().bindVertexArray(VAO);
+    glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, externalCommands);
+    glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (void *)0,
+                                externalCount, 0);
+    return;
+  }
+  if (commands.empty())
+    return;
+
+  if (indirect()) {
+    instances.setFirstInstance(0);
+    glState().bindVertexArray(VAO);
+
+    // orphaned every frame, the GPU may still read last frame's commands
+    size_t bytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+    indirectCapacity = std::max(indirectCapacity, bytes);
+    glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, NULL,
+                 GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, commands.data());
+
+    glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (void *)0,
+                                (GLsizei)commands.size(), 0);
+    return;
+  }
+
+  for (const DrawElementsIndirectCommand &command : commands) {
+    instances.setFirstInstance(command.baseInstance);
+    glState().bindVertexArray(VAO);
+    glDrawElementsInstancedBaseVertex(
+        mode, command.count, GL_UNSIGNED_INT,
+        (void *)(command.firstIndex * sizeof(uint32_t)),
+        command.instanceCount, command.baseVertex);
+  }
+}
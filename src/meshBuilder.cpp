@@ -0,0 +1,248 @@
+#include "meshBuilder.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Forsyth's scoring constants
+const int SCORE_CACHE_SIZE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+uint32_t hashVertex(const float *vertex, unsigned int floats) {
+  // FNV-1a over the bits, -0.0 hashes and compares like 0.0
+  uint32_t hash = 2166136261u;
+  for (unsigned int i = 0; i < floats; i++) {
+    float value = vertex[i] == 0.0f ? 0.0f : vertex[i];
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int byte = 0; byte < 4; byte++) {
+      hash ^= (bits >> (byte * 8)) & 0xff;
+      hash *= 16777619u;
+    }
+  }
+  return hash;
+}
+
+bool sameVertex(const float *a, const float *b, unsigned int floats) {
+  for (unsigned int i = 0; i < floats; i++)
+    if (a[i] != b[i])
+      return false;
+  return true;
+}
+
+float vertexScore(int cachePosition, int remainingTriangles) {
+  // nothing left to draw, the vertex is worthless
+  if (remainingTriangles == 0)
+    return -1.0f;
+
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // the last triangle's vertices get a fixed score, so the order stays
+      // independent of which of them was added last
+      score = LAST_TRIANGLE_SCORE;
+    } else {
+      const float scaler = 1.0f / (SCORE_CACHE_SIZE - 3);
+      score = 1.0f - (cachePosition - 3) * scaler;
+      score = std::pow(score, CACHE_DECAY_POWER);
+    }
+  }
+
+  // vertices with few triangles left are worth finishing off
+  score += VALENCE_BOOST_SCALE *
+           std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+  return score;
+}
+
+} // namespace
+
+IndexedMesh weldVertices(const std::vector<float> &vertices,
+                         unsigned int vertexFloats) {
+  IndexedMesh mesh;
+  size_t count = vertices.size() / vertexFloats;
+
+  // open addressed table of output vertex ids, capacity a power of two
+  size_t capacity = 16;
+  while (capacity < count * 2)
+    capacity *= 2;
+  const uint32_t EMPTY = 0xffffffffu;
+  std::vector<uint32_t> table(capacity, EMPTY);
+
+  mesh.indices.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    const float *vertex = &vertices[i * vertexFloats];
+    size_t slot = hashVertex(vertex, vertexFloats) & (capacity - 1);
+    while (table[slot] != EMPTY &&
+           !sameVertex(&mesh.vertices[table[slot] * vertexFloats], vertex,
+                       vertexFloats))
+      slot = (slot + 1) & (capacity - 1);
+
+    if (table[slot] == EMPTY) {
+      table[slot] = (uint32_t)(mesh.vertices.size() / vertexFloats);
+      mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + vertexFloats);
+    }
+    mesh.indices.push_back(table[slot]);
+  }
+  return mesh;
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0)
+    return;
+
+  // triangles of every vertex, packed by vertex
+  std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+  for (uint32_t index : indices)
+    firstTriangle[index + 1]++;
+  for (size_t v = 0; v < vertexCount; v++)
+    firstTriangle[v + 1] += firstTriangle[v];
+  std::vector<uint32_t> vertexTriangles(indices.size());
+  std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++)
+    vertexTriangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+
+  // remaining counts only ever shrink, the live triangles of a vertex are
+  // the first remaining[v] of its list
+  std::vector<int> remaining(vertexCount);
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> score(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++) {
+    remaining[v] = (int)(firstTriangle[v + 1] - firstTriangle[v]);
+    score[v] = vertexScore(-1, remaining[v]);
+  }
+
+  std::vector<uint8_t> added(triangleCount, 0);
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+  // one slot per possible entry plus the three being added
+  std::vector<uint32_t> cache, nextCache;
+  cache.reserve(SCORE_CACHE_SIZE + 3);
+  nextCache.reserve(SCORE_CACHE_SIZE + 3);
+
+  size_t scanFrom = 0;
+  int best = -1;
+  for (size_t emitted = 0; emitted < triangleCount; emitted++) {
+    // nothing in the cache has triangles left, take the next unused one
+    if (best < 0) {
+      while (added[scanFrom])
+        scanFrom++;
+      best = (int)scanFrom;
+    }
+
+    const uint32_t *triangle = &indices[best * 3];
+    added[best] = 1;
+    output.insert(output.end(), triangle, triangle + 3);
+
+    // drop the triangle from its vertices' live lists
+    for (int corner = 0; corner < 3; corner++) {
+      uint32_t v = triangle[corner];
+      uint32_t *list = &vertexTriangles[firstTriangle[v]];
+      int live = remaining[v];
+      for (int i = 0; i < live; i++) {
+        if (list[i] == (uint32_t)best) {
+          list[i] = list[live - 1];
+          list[live - 1] = (uint32_t)best;
+          break;
+        }
+      }
+      remaining[v]--;
+    }
+
+    // the triangle's vertices move to the front of the LRU cache
+    nextCache.assign(triangle, triangle + 3);
+    for (uint32_t v : cache)
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+        nextCache.push_back(v);
+    cache.swap(nextCache);
+
+    // rescore every vertex that moved, the ones pushed out included
+    for (size_t i = 0; i < cache.size(); i++) {
+      uint32_t v = cache[i];
+      cachePosition[v] = i < (size_t)SCORE_CACHE_SIZE ? (int)i : -1;
+      score[v] = vertexScore(cachePosition[v], remaining[v]);
+    }
+    if (cache.size() > (size_t)SCORE_CACHE_SIZE)
+      cache.resize(SCORE_CACHE_SIZE);
+
+    // the next triangle is the best one touching the cache
+    best = -1;
+    float bestScore = -1.0f;
+    for (uint32_t v : cache) {
+      const uint32_t *list = &vertexTriangles[firstTriangle[v]];
+      for (int i = 0; i < remaining[v]; i++) {
+        uint32_t t = list[i];
+        float sum = score[indices[t * 3]] + score[indices[t * 3 + 1]] +
+                    score[indices[t * 3 + 2]];
+        if (sum > bestScore) {
+          bestScore = sum;
+          best = (int)t;
+        }
+      }
+    }
+  }
+
+  indices.swap(output);
+}
+
+void optimizeVertexFetch(IndexedMesh &mesh, unsigned int vertexFloats) {
+  const size_t vertexCount = mesh.vertices.size() / vertexFloats;
+  const uint32_t UNUSED = 0xffffffffu;
+  std::vector<uint32_t> remap(vertexCount, UNUSED);
+  std::vector<float> vertices;
+  vertices.reserve(mesh.vertices.size());
+
+  for (uint32_t &index : mesh.indices) {
+    if (remap[index] == UNUSED) {
+      remap[index] = (uint32_t)(vertices.size() / vertexFloats);
+      const float *vertex = &mesh.vertices[index * vertexFloats];
+      vertices.insert(vertices.end(), vertex, vertex + vertexFloats);
+    }
+    index = remap[index];
+  }
+  // vertices no triangle uses are dropped
+  mesh.vertices.swap(vertices);
+}
+
+float computeAcmr(const std::vector<uint32_t> &indices, size_t vertexCount,
+                  unsigned int cacheSize) {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0)
+    return 0.0f;
+
+  // a vertex is cached while fewer than cacheSize misses came after it
+  std::vector<size_t> missedAt(vertexCount, 0);
+  size_t misses = 0;
+  for (uint32_t index : indices) {
+    if (missedAt[index] == 0 || misses - missedAt[index] >= cacheSize) {
+      misses++;
+      missedAt[index] = misses;
+    }
+  }
+  return (float)misses / (float)triangleCount;
+}
+
+IndexedMesh buildIndexedMesh(const std::vector<float> &vertices,
+                             unsigned int vertexFloats,
+                             MeshBuildStats *stats) {
+  IndexedMesh mesh = weldVertices(vertices, vertexFloats);
+  size_t vertexCount = mesh.vertices.size() / vertexFloats;
+  if (stats) {
+    stats->inputVertices = vertices.size() / vertexFloats;
+    stats->acmrBefore = computeAcmr(mesh.indices, vertexCount);
+  }
+
+  optimizeVertexCache(mesh.indices, vertexCount);
+  optimizeVertexFetch(mesh, vertexFloats);
+
+  if (stats) {
+    stats->outputVertices = mesh.vertices.size() / vertexFloats;
+    stats->acmrAfter = computeAcmr(mesh.indices, stats->outputVertices);
+  }
+  return mesh;
+}
@@ -0,0 +1,42 @@
+#include "offscreenTarget.h"
+#include "glState.h"
+
+#include <iostream>
+
+OffscreenTarget::OffscreenTarget(int width, int height)
+    : targetWidth(width), targetHeight(height) {
+  glGenFramebuffers(1, &FBO);
+  glState().bindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+  glGenRenderbuffers(1, &colorRBO);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, colorRBO);
+
+  glGenRenderbuffers(1, &depthRBO);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, depthRBO);
+
+  isComplete =
+      glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  if (!isComplete)
+    std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE" << std::endl;
+
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glState().bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+OffscreenTarget::~OffscreenTarget() {
+  glDeleteFramebuffers(1, &FBO);
+  glDeleteRenderbuffers(1, &colorRBO);
+  glDeleteRenderbuffers(1, &depthRBO);
+  glState().invalidate();
+}
+
+void OffscreenTarget::bind() const {
+  glState().bindFramebuffer(GL_FRAMEBUFFER, FBO);
+  glViewport(0, 0, targetWidth, targetHeight);
+}
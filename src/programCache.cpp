@@ -0,0 +1,140 @@
+#include "programCache.h"
+#include "glExtensions.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 0x42504c47; // "GLPB"
+
+struct CacheHeader {
+  uint32_t magic;
+  uint32_t format;
+  uint64_t key;
+  uint64_t length;
+};
+
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t hashString(uint64_t hash, const std::string &value) {
+  // include the length so ("ab", "c") and ("a", "bc") differ
+  uint64_t length = value.size();
+  hash = hashBytes(hash, &length, sizeof(length));
+  return hashBytes(hash, value.data(), value.size());
+}
+
+std::string glString(GLenum name) {
+  const char *value = (const char *)glGetString(name);
+  return value ? value : "";
+}
+
+} // namespace
+
+ProgramCache::ProgramCache(const std::string &directory)
+    : directory(directory) {
+  GLint formats = 0;
+  if (GLEXT_ARB_get_program_binary)
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  supported = formats > 0;
+  if (!supported)
+    return;
+
+  driverHash = 14695981039346656037ull;
+  driverHash = hashString(driverHash, glString(GL_VENDOR));
+  driverHash = hashString(driverHash, glString(GL_RENDERER));
+  driverHash = hashString(driverHash, glString(GL_VERSION));
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    std::cout << "ERROR::PROGRAM_CACHE::CANNOT_CREATE_DIRECTORY\n"
+              << directory << ": " << error.message() << std::endl;
+    supported = false;
+  }
+}
+
+uint64_t ProgramCache::makeKey(const std::string &vertexCode,
+                               const std::string &fragmentCode) const {
+  uint64_t key = hashString(driverHash, vertexCode);
+  return hashString(key, fragmentCode);
+}
+
+std::string ProgramCache::entryPath(uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+  return directory + "/" + name;
+}
+
+bool ProgramCache::load(unsigned int program, uint64_t key) const {
+  if (!supported)
+    return false;
+
+  std::ifstream file(entryPath(key), std::ios::binary | std::ios::ate);
+  if (!file)
+    return false;
+  const uint64_t fileSize = (uint64_t)file.tellg();
+  file.seekg(0);
+
+  CacheHeader header;
+  if (fileSize < sizeof(header) ||
+      !file.read((char *)&header, sizeof(header)) ||
+      header.magic != CACHE_MAGIC || header.key != key)
+    return false;
+  // a truncated or corrupt entry is a miss, never a huge allocation
+  if (header.length == 0 || header.length != fileSize - sizeof(header))
+    return false;
+
+  std::vector<char> binary(header.length);
+  if (!file.read(binary.data(), binary.size()))
+    return false;
+
+  // the driver rejects binaries it no longer understands
+  glProgramBinary(program, header.format, binary.data(),
+                  (GLsizei)binary.size());
+  GLint success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  return success != 0;
+}
+
+void ProgramCache::store(unsigned int program, uint64_t key) const {
+  if (!supported)
+    return;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, NULL, &format, binary.data());
+
+  CacheHeader header = {CACHE_MAGIC, format, key, (uint64_t)length};
+
+  // write to a temporary name first so a crash never leaves a torn entry
+  std::string path = entryPath(key);
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write((const char *)&header, sizeof(header));
+    file.write(binary.data(), binary.size());
+    if (!file) {
+      std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED\n"
+                << temporary << std::endl;
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+}
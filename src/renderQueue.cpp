@@ -0,0 +1,176 @@
+#include "renderQueue.h"
+#include "glState.h"
+#include "meshBatch.h"
+
+#include <algorithm>
+
+uint64_t RenderQueue::makeKey(unsigned int pass, unsigned int program,
+                              unsigned int textureSet, unsigned int vao,
+                              float depth) {
+  depth = std::min(std::max(depth, 0.0f), 1.0f);
+  uint64_t quantized = (uint64_t)(depth * 16777215.0f);
+  return ((uint64_t)(pass & 0xf) << 60) |
+         ((uint64_t)(program & 0xfff) << 48) |
+         ((uint64_t)(textureSet & 0xfff) << 36) |
+         ((uint64_t)(vao & 0xfff) << 24) | quantized;
+}
+
+unsigned int RenderQueue::addProgram(const Shader &shader) {
+  programs.push_back(Program{shader.ID, shader.uniform("model"_u)});
+  return (unsigned int)programs.size() - 1;
+}
+
+void RenderQueue::updateProgram(unsigned int program, const Shader &shader) {
+  programs[program] = Program{shader.ID, shader.uniform("model"_u)};
+}
+
+unsigned int RenderQueue::addTextureSet(const std::vector<GLuint> &textures) {
+  textureSets.push_back(textures);
+  return (unsigned int)textureSets.size() - 1;
+}
+
+unsigned int RenderQueue::addVertexArray(GLuint vao) {
+  vertexArrays.push_back(vao);
+  return (unsigned int)vertexArrays.size() - 1;
+}
+
+unsigned int RenderQueue::addBatch(MeshBatch &batch,
+                                   InstancedRenderer &instances) {
+  batches.push_back(
+      Batch{&batch, &instances, addVertexArray(batch.vertexArray())});
+  return (unsigned int)batches.size() - 1;
+}
+
+void RenderQueue::clear() {
+  entries.clear();
+  items.clear();
+  models.clear();
+}
+
+void RenderQueue::submit(unsigned int pass, unsigned int program,
+                         unsigned int textureSet, unsigned int vao,
+                         float depth, GLenum mode, GLint first, GLsizei count,
+                         GLsizei instances) {
+  entries.push_back(
+      Entry{makeKey(pass, program, textureSet, vao, depth),
+            (uint32_t)items.size()});
+  items.push_back(DrawItem{(uint16_t)program, (uint16_t)textureSet,
+                           (uint16_t)vao, (uint16_t)mode, NO_BATCH, first,
+                           count, instances, NO_MODEL});
+}
+
+void RenderQueue::submit(unsigned int pass, unsigned int program,
+                         unsigned int textureSet, unsigned int vao,
+                         float depth, GLenum mode, GLint first, GLsizei count,
+                         GLsizei instances, const glm::mat4 &model) {
+  submit(pass, program, textureSet, vao, depth, mode, first, count,
+         instances);
+  items.back().model = (uint32_t)models.size();
+  models.push_back(model);
+}
+
+void RenderQueue::submitBatch(unsigned int pass, unsigned int program,
+                              unsigned int textureSet, unsigned int batch,
+                              float depth, GLenum mode,
+                              const glm::mat4 &model) {
+  submit(pass, program, textureSet, batches[batch].vao, depth, mode, 0, 0, 0,
+         model);
+  items.back().batch = (uint16_t)batch;
+}
+
+void RenderQueue::sort() {
+  size_t count = entries.size();
+  if (count < 2)
+    return;
+  scratch.resize(count);
+
+  Entry *source = entries.data();
+  Entry *destination = scratch.data();
+
+  // histogram every byte in a single pass over the keys
+  size_t histograms[8][256] = {};
+  for (size_t i = 0; i < count; i++) {
+    uint64_t key = source[i].key;
+    for (int digit = 0; digit < 8; digit++)
+      histograms[digit][(key >> (digit * 8)) & 0xff]++;
+  }
+
+  for (int digit = 0; digit < 8; digit++) {
+    size_t *histogram = histograms[digit];
+
+    // every key shares this byte, the pass would not move anything
+    uint8_t firstByte = (source[0].key >> (digit * 8)) & 0xff;
+    if (histogram[firstByte] == count)
+      continue;
+
+    size_t offset = 0;
+    for (int bucket = 0; bucket < 256; bucket++) {
+      size_t bucketCount = histogram[bucket];
+      histogram[bucket] = offset;
+      offset += bucketCount;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      uint8_t byte = (source[i].key >> (digit * 8)) & 0xff;
+      destination[histogram[byte]++] = source[i];
+    }
+    std::swap(source, destination);
+  }
+
+  if (source != entries.data())
+    entries.swap(scratch);
+}
+
+template <bool issue> RenderQueue::ExecuteStats RenderQueue::walk() const {
+  ExecuteStats stats;
+  int program = -1, textureSet = -1, vao = -1;
+
+  for (const Entry &entry : entries) {
+    const DrawItem &item = items[entry.item];
+
+    if (item.program != program) {
+      program = item.program;
+      stats.programChanges++;
+      if (issue)
+        glState().useProgram(programs[program].id);
+    }
+    if (item.textureSet != textureSet) {
+      textureSet = item.textureSet;
+      stats.textureChanges++;
+      if (issue) {
+        const std::vector<GLuint> &textures = textureSets[textureSet];
+        for (unsigned int unit = 0; unit < textures.size(); unit++)
+          glState().bindTexture(unit, GL_TEXTURE_2D, textures[unit]);
+      }
+    }
+    if (item.vao != vao) {
+      vao = item.vao;
+      stats.vaoChanges++;
+      if (issue)
+        glState().bindVertexArray(vertexArrays[vao]);
+    }
+
+    stats.draws++;
+    if (!issue)
+      continue;
+
+    if (item.model != NO_MODEL && programs[program].model.valid())
+      glUniformMatrix4fv(programs[program].model.location, 1, GL_FALSE,
+                         glm::value_ptr(models[item.model]));
+    if (item.batch != NO_BATCH)
+      batches[item.batch].batch->draw(item.mode,
+                                      *batches[item.batch].instances);
+    else if (item.instances == 1)
+      glDrawArrays(item.mode, item.first, item.count);
+    else
+      glDrawArraysInstanced(item.mode, item.first, item.count,
+                            item.instances);
+  }
+  return stats;
+}
+
+RenderQueue::ExecuteStats RenderQueue::execute() const { return walk<true>(); }
+
+RenderQueue::ExecuteStats RenderQueue::simulate() const {
+  return walk<false>();
+}
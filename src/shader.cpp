@@ -1,104 +1,159 @@
 #include "shader.h"
+#include "frameUniforms.h"
+#include "glExtensions.h"
+#include "glState.h"
+#include "shaderCompiler.h"
+#include "shaderPreprocessor.h"
+
+#include <algorithm>
+
+Shader::Shader(const char *vertexPath, const char *fragmentPath,
+               ShaderCompiler &compiler,
+               const std::vector<std::string> &defines)
+    : ID(0), sources{{GL_VERTEX_SHADER, vertexPath},
+                     {GL_FRAGMENT_SHADER, fragmentPath}},
+      defines(defines) {
+  compiler.submit(*this);
+}
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath) {
-  std::string vertexCode;
-  std::string fragmentCode;
-
-  std::ifstream vShaderFile;
-  std::ifstream fShaderFile;
-
-  vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-  try {
-    // open files
-    vShaderFile.open(vertexPath);
-    fShaderFile.open(fragmentPath);
-    std::stringstream vShaderStream, fShaderStream;
-
-    // read contents into streams
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
+Shader::Shader(const char *computePath, ShaderCompiler &compiler)
+    : ID(0), sources{{GL_COMPUTE_SHADER, computePath}} {
+  compiler.submit(*this);
+}
 
-    // close files
-    vShaderFile.close();
-    fShaderFile.close();
+std::vector<std::string> Shader::sourcePaths() const {
+  std::vector<std::string> paths;
+  for (const Source &source : sources)
+    paths.push_back(source.path);
+  paths.insert(paths.end(), includes.begin(), includes.end());
+  return paths;
+}
 
-    // convert stream to string
-    vertexCode = vShaderStream.str();
-    fragmentCode = fShaderStream.str();
+std::vector<std::string> Shader::readSources(bool fromDisk) {
+  std::vector<std::string> code;
+  std::vector<std::string> files;
+  includes.clear();
+  for (const Source &source : sources) {
+    code.push_back(shaderPreprocessor().process(source.path, defines,
+                                                fromDisk, files));
+    // files[0] is the source itself
+    for (size_t i = 1; i < files.size(); i++)
+      if (std::find(includes.begin(), includes.end(), files[i]) ==
+          includes.end())
+        includes.push_back(files[i]);
+  }
+  return code;
+}
 
+const char *Shader::stageName(GLenum type) {
+  switch (type) {
+  case GL_VERTEX_SHADER:
+    return "VERTEX";
+  case GL_FRAGMENT_SHADER:
+    return "FRAGMENT";
+  case GL_COMPUTE_SHADER:
+    return "COMPUTE";
   }
+  return "UNKNOWN";
+}
 
-  catch (std::ifstream::failure e) {
-    std::cout << "ERROR shader file not successfully read" << std::endl;
+void Shader::reflectUniforms() {
+  // block bindings are not part of a program binary, so this runs after
+  // loading one as well
+  FrameUniforms::attach(ID);
+
+  int count = 0;
+  int maxLength = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+  // keep the load factor at or below one half
+  size_t capacity = 8;
+  while (capacity < (size_t)count * 2)
+    capacity *= 2;
+  uniforms.assign(capacity, UniformSlot{});
+
+  std::vector<char> name(maxLength > 0 ? maxLength : 1);
+  for (int i = 0; i < count; i++) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(ID, i, (GLsizei)name.size(), &length, &size, &type,
+                       name.data());
+
+    // uniforms inside blocks have no location
+    GLint location = glGetUniformLocation(ID, name.data());
+    if (location < 0)
+      continue;
+
+    // arrays are reported as "name[0]", register them as "name"
+    if (length > 3 && std::string(name.data() + length - 3) == "[0]")
+      length -= 3;
+
+    uint32_t hash = hashUniformName(name.data(), length);
+    size_t slot = hash & (capacity - 1);
+    while (uniforms[slot].location >= 0) {
+      if (uniforms[slot].hash == hash) {
+        std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION\n"
+                  << std::string(name.data(), length) << std::endl;
+        break;
+      }
+      slot = (slot + 1) & (capacity - 1);
+    }
+    uniforms[slot].hash = hash;
+    uniforms[slot].location = location;
   }
+}
 
-  const char *vShaderCode = vertexCode.c_str();
-  const char *fShaderCode = fragmentCode.c_str();
-
-  unsigned int vertex, fragment;
-  int success;
-  char infoLog[512];
-  vertex = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertex, 1, &vShaderCode, NULL);
-  glCompileShader(vertex);
-  // print compile errors if any
-  glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-    std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n"
-              << infoLog << std::endl;
-  };
-
-  fragment = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragment, 1, &fShaderCode, NULL);
-  glCompileShader(fragment);
-  // print compile errors if any
-  glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-  if (!success) {
-    glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-    std::cout << "ERROR::SHADER::fragment::COMPILATION_FAILED\n"
-              << infoLog << std::endl;
-  };
-
-  ID = glCreateProgram();
-
-  glAttachShader(ID, vertex);
-  glAttachShader(ID, fragment);
-  glLinkProgram(ID);
-  // print linking errors if any
-  glGetProgramiv(ID, GL_LINK_STATUS, &success);
-  if (!success) {
-    glGetProgramInfoLog(ID, 512, NULL, infoLog);
-    std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
-              << infoLog << std::endl;
+void Shader::use() { glState().useProgram(ID); }
+
+UniformHandle Shader::uniform(UniformName name) const {
+  // not built yet
+  if (uniforms.empty())
+    return UniformHandle{};
+  size_t mask = uniforms.size() - 1;
+  for (size_t slot = name.hash & mask;; slot = (slot + 1) & mask) {
+    const UniformSlot &entry = uniforms[slot];
+    if (entry.location < 0)
+      return UniformHandle{};
+    if (entry.hash == name.hash)
+      return UniformHandle{entry.location};
   }
-  // delete shaders; they’re linked into our program and no longer necessary
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
 }
 
-void Shader::use() { glUseProgram(ID); }
+UniformHandle Shader::uniform(const std::string &name) const {
+  return uniform(UniformName{hashUniformName(name.data(), name.size())});
+}
+
+void Shader::setBool(UniformHandle handle, bool value) const {
+  glUniform1i(handle.location, (int)value);
+}
+void Shader::setInt(UniformHandle handle, int value) const {
+  glUniform1i(handle.location, value);
+}
+void Shader::setFloat(UniformHandle handle, float value) const {
+  glUniform1f(handle.location, value);
+}
+void Shader::setMat4(UniformHandle handle, const glm::mat4 &matrix) const {
+  glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(matrix));
+}
 
 void Shader::setBool(const std::string &name, bool value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+  setBool(uniform(name), value);
 }
 void Shader::setInt(const std::string &name, int value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+  setInt(uniform(name), value);
 }
 void Shader::setFloat(const std::string &name, float value) const {
-  glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+  setFloat(uniform(name), value);
 }
 
 float Shader::getFloat(const std::string &name) const {
   float value;
-  glGetUniformfv(this->ID, glGetUniformLocation(this->ID, name.c_str()),
-                 &value);
+  glGetUniformfv(this->ID, uniform(name).location, &value);
   return value;
 };
 
 void Shader::setMat4(const std::string &name, glm::mat4 matrix) const {
-  glUniformMatrix4fv(glGetUniformLocation(this->ID, name.c_str()), 1, GL_FALSE,
-                     glm::value_ptr(matrix));
+  setMat4(uniform(name), matrix);
 }
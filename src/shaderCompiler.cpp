@@ -0,0 +1,281 @@
+#include "shaderCompiler.h"
+#include "glExtensions.h"
+#include "glState.h"
+#include "programCache.h"
+#include "shader.h"
+
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+} // namespace
+
+ShaderCompiler::ShaderCompiler(GLFWwindow *window, const ProgramCache *cache)
+    : cache(cache) {
+  if (GLEXT_KHR_parallel_shader_compile) {
+    buildMode = Mode::Parallel;
+    return;
+  }
+  if (!window)
+    return;
+
+  // glad's entry points were loaded through the window's context and work
+  // for this one as well, both come from the same driver
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  context = glfwCreateWindow(1, 1, "", NULL, window);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+  if (!context)
+    return;
+  buildMode = Mode::Worker;
+  worker = std::thread(&ShaderCompiler::workerLoop, this);
+}
+
+ShaderCompiler::~ShaderCompiler() {
+  if (worker.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    jobReady.notify_all();
+    worker.join();
+  }
+  if (context)
+    glfwDestroyWindow(context);
+}
+
+void ShaderCompiler::submit(Shader &shader) { enqueue(shader, false); }
+
+void ShaderCompiler::reload(Shader &shader) { enqueue(shader, true); }
+
+void ShaderCompiler::enqueue(Shader &shader, bool reload) {
+  std::unique_ptr<Job> job(new Job);
+  job->shader = &shader;
+  job->reload = reload;
+  job->code = shader.readSources(reload);
+  for (const Shader::Source &source : shader.sources) {
+    job->types.push_back(source.type);
+    job->timing.name += (job->timing.name.empty() ? "" : " ") + source.path;
+  }
+  // most likely caught between an editor's truncate and write, the next
+  // event brings the whole file
+  for (const std::string &code : job->code)
+    if (reload && code.empty())
+      return;
+
+  if (reload)
+    for (const std::unique_ptr<Job> &other : jobs)
+      if (other->shader == &shader && other->reload)
+        other->superseded = true;
+
+  // a cached binary skips compiling and linking altogether
+  job->start = Clock::now();
+  if (cache && cache->enabled()) {
+    // no graphics program has an empty fragment stage, so the keys never
+    // collide
+    job->cacheKey = cache->makeKey(
+        job->code[0], job->code.size() > 1 ? job->code[1] : std::string());
+    job->program = glCreateProgram();
+    if (cache->load(job->program, job->cacheKey)) {
+      job->timing.cached = true;
+      job->timing.linked = true;
+      job->timing.linkMs = elapsedMs(job->start);
+      job->done = true;
+      jobs.push_back(std::move(job));
+      return;
+    }
+    glDeleteProgram(job->program);
+    job->program = 0;
+  }
+
+  Job &queued = *job;
+  jobs.push_back(std::move(job));
+  switch (buildMode) {
+  case Mode::Parallel:
+    submitStages(queued);
+    submitLink(queued);
+    break;
+  case Mode::Worker: {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(&queued);
+    jobReady.notify_one();
+    break;
+  }
+  case Mode::Blocking:
+    build(queued);
+    queued.done = true;
+    break;
+  }
+}
+
+void ShaderCompiler::submitStages(Job &job) {
+  for (size_t i = 0; i < job.code.size(); i++) {
+    const char *source = job.code[i].c_str();
+    unsigned int stage = glCreateShader(job.types[i]);
+    glShaderSource(stage, 1, &source, NULL);
+    glCompileShader(stage);
+    job.stages.push_back(stage);
+  }
+}
+
+void ShaderCompiler::submitLink(Job &job) {
+  job.program = glCreateProgram();
+  if (cache && cache->enabled())
+    glProgramParameteri(job.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  for (unsigned int stage : job.stages)
+    glAttachShader(job.program, stage);
+  glLinkProgram(job.program);
+}
+
+void ShaderCompiler::checkStages(Job &job) {
+  for (size_t i = 0; i < job.stages.size(); i++) {
+    int success;
+    char infoLog[512];
+    glGetShaderiv(job.stages[i], GL_COMPILE_STATUS, &success);
+    if (!success) {
+      glGetShaderInfoLog(job.stages[i], 512, NULL, infoLog);
+      job.log += std::string("ERROR::SHADER::") +
+                 Shader::stageName(job.types[i]) + "::COMPILATION_FAILED\n" +
+                 infoLog + "\n";
+    }
+  }
+}
+
+void ShaderCompiler::checkLink(Job &job) {
+  int success;
+  char infoLog[512];
+  glGetProgramiv(job.program, GL_LINK_STATUS, &success);
+  if (!success) {
+    glGetProgramInfoLog(job.program, 512, NULL, infoLog);
+    job.log += std::string("ERROR::SHADER::PROGRAM::LINKING_FAILED\n") +
+               infoLog + "\n";
+  }
+  job.timing.linked = success != 0;
+}
+
+void ShaderCompiler::release(Job &job) {
+  if (job.timing.linked && cache && cache->enabled())
+    cache->store(job.program, job.cacheKey);
+  // linked into the program and no longer necessary
+  for (unsigned int stage : job.stages)
+    glDeleteShader(stage);
+  job.stages.clear();
+}
+
+void ShaderCompiler::build(Job &job) {
+  submitStages(job);
+  checkStages(job);
+  job.timing.compileMs = elapsedMs(job.start);
+  submitLink(job);
+  checkLink(job);
+  job.timing.linkMs = elapsedMs(job.start) - job.timing.compileMs;
+  release(job);
+}
+
+bool ShaderCompiler::poll(Job &job) {
+  GLint complete = GL_FALSE;
+  if (!job.compiled) {
+    for (unsigned int stage : job.stages) {
+      glGetShaderiv(stage, GL_COMPLETION_STATUS_KHR, &complete);
+      if (!complete)
+        return false;
+    }
+    job.compiled = true;
+    job.timing.compileMs = elapsedMs(job.start);
+  }
+  glGetProgramiv(job.program, GL_COMPLETION_STATUS_KHR, &complete);
+  if (!complete)
+    return false;
+  job.timing.linkMs = elapsedMs(job.start) - job.timing.compileMs;
+
+  // done, so none of these wait
+  checkStages(job);
+  checkLink(job);
+  release(job);
+  job.done = true;
+  return true;
+}
+
+bool ShaderCompiler::adopt(Job &job) {
+  if (job.superseded) {
+    glDeleteProgram(job.program);
+    return false;
+  }
+  if (!job.log.empty())
+    std::cout << job.log << std::flush;
+  finished.push_back(job.timing);
+  if (job.reload && !job.timing.linked) {
+    glDeleteProgram(job.program);
+    return false;
+  }
+
+  Shader &shader = *job.shader;
+  if (shader.ID) {
+    glDeleteProgram(shader.ID);
+    // the new program may reuse the old name
+    glState().invalidate();
+  }
+  shader.ID = job.program;
+  shader.reflectUniforms();
+  return true;
+}
+
+bool ShaderCompiler::update() {
+  bool swapped = false;
+  for (size_t i = 0; i < jobs.size();) {
+    Job &job = *jobs[i];
+    bool done;
+    if (buildMode == Mode::Worker) {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = job.done;
+    } else {
+      done = job.done || poll(job);
+    }
+    if (!done) {
+      i++;
+      continue;
+    }
+    if (adopt(job))
+      swapped = true;
+    jobs.erase(jobs.begin() + (std::ptrdiff_t)i);
+  }
+  return swapped;
+}
+
+void ShaderCompiler::finish() {
+  while (!jobs.empty()) {
+    update();
+    if (!jobs.empty())
+      std::this_thread::yield();
+  }
+}
+
+void ShaderCompiler::workerLoop() {
+  glfwMakeContextCurrent(context);
+  for (;;) {
+    Job *job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobReady.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (stopping)
+        break;
+      job = queue.front();
+      queue.pop_front();
+    }
+    build(*job);
+    // objects made here are only safe to use in the window's context once
+    // this context has finished them
+    glFinish();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    job->done = true;
+  }
+  glfwMakeContextCurrent(NULL);
+}
@@ -0,0 +1,145 @@
+#include "shaderPreprocessor.h"
+#include "assetPack.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+bool readFile(const std::string &path, std::string &code) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  std::stringstream stream;
+  stream << file.rdbuf();
+  code = stream.str();
+  return true;
+}
+
+// the quoted name of an #include line, false for any other line
+bool parseInclude(const std::string &line, std::string &name) {
+  size_t start = line.find_first_not_of(" \t");
+  if (start == std::string::npos || line.compare(start, 1, "#") != 0)
+    return false;
+  start = line.find_first_not_of(" \t", start + 1);
+  if (start == std::string::npos || line.compare(start, 7, "include") != 0)
+    return false;
+  size_t open = line.find('"', start + 7);
+  size_t close =
+      open == std::string::npos ? open : line.find('"', open + 1);
+  if (close == std::string::npos)
+    return false;
+  name = line.substr(open + 1, close - open - 1);
+  return true;
+}
+
+bool isVersion(const std::string &line) {
+  size_t start = line.find_first_not_of(" \t");
+  return start != std::string::npos && line.compare(start, 8, "#version") == 0;
+}
+
+} // namespace
+
+const std::string *ShaderPreprocessor::load(const std::string &path,
+                                            bool fromDisk) {
+  if (!fromDisk) {
+    auto cached = cache.find(path);
+    if (cached != cache.end())
+      return &cached->second;
+
+    std::vector<uint8_t> scratch;
+    size_t size = 0;
+    const uint8_t *packed = sourceDirectory.empty()
+                                ? assetPack().bytes(path, scratch, size)
+                                : nullptr;
+    if (packed)
+      return &(cache[path] = std::string((const char *)packed, size));
+  }
+
+  std::string code;
+  if (!readFile(diskPath(path), code)) {
+    std::cout << "ERROR shader file not successfully read: "
+              << diskPath(path) << std::endl;
+    return nullptr;
+  }
+  return &(cache[path] = std::move(code));
+}
+
+void ShaderPreprocessor::setSourceDirectory(const std::string &directory) {
+  sourceDirectory = directory;
+  if (!sourceDirectory.empty() && sourceDirectory.back() != '/')
+    sourceDirectory += '/';
+  // what was read so far came from elsewhere
+  cache.clear();
+}
+
+std::string ShaderPreprocessor::process(const std::string &path,
+                                        const std::vector<std::string> &defines,
+                                        bool fromDisk,
+                                        std::vector<std::string> &files) {
+  files.clear();
+  std::string out;
+  if (!expand(path, &defines, fromDisk, files, out))
+    return std::string();
+  return out;
+}
+
+bool ShaderPreprocessor::expand(const std::string &path,
+                                const std::vector<std::string> *defines,
+                                bool fromDisk, std::vector<std::string> &files,
+                                std::string &out) {
+  const std::string *code = load(path, fromDisk);
+  if (!code)
+    return false;
+  const size_t index = files.size();
+  files.push_back(path);
+  const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+
+  // #version has to stay first, so the top file starts numbering itself
+  if (index > 0)
+    out += "#line 1 " + std::to_string(index) + "\n";
+
+  std::istringstream lines(*code);
+  std::string line;
+  for (unsigned int number = 1; std::getline(lines, line); number++) {
+    std::string name;
+    if (parseInclude(line, name)) {
+      std::string included = directory + name;
+      if (std::find(files.begin(), files.end(), included) == files.end()) {
+        if (!expand(included, nullptr, fromDisk, files, out)) {
+          std::cout << "ERROR::SHADER::INCLUDE_FAILED\n"
+                    << included << " from " << path << std::endl;
+          return false;
+        }
+      }
+      out += "#line " + std::to_string(number + 1) + " " +
+             std::to_string(index) + "\n";
+      continue;
+    }
+
+    out += line;
+    out += '\n';
+    if (defines && isVersion(line)) {
+      for (const std::string &define : *defines)
+        out += "#define " + define + "\n";
+      if (!defines->empty())
+        out += "#line " + std::to_string(number + 1) + " 0\n";
+      defines = nullptr;
+    }
+  }
+  // no #version, nothing to keep in front of the defines
+  if (defines && !defines->empty()) {
+    std::string prefix;
+    for (const std::string &define : *defines)
+      prefix += "#define " + define + "\n";
+    out.insert(0, prefix + "#line 1 0\n");
+  }
+  return true;
+}
+
+ShaderPreprocessor &shaderPreprocessor() {
+  static ShaderPreprocessor preprocessor;
+  return preprocessor;
+}
@@ -0,0 +1,36 @@
+#include "shaderVariants.h"
+#include "shaderCompiler.h"
+
+#include <iostream>
+
+ShaderVariants::ShaderVariants(const char *vertexPath,
+                               const char *fragmentPath,
+                               const std::vector<std::string> &options,
+                               ShaderCompiler &compiler)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath), options(options),
+      compiler(compiler) {
+  validBits = options.size() >= MAX_OPTIONS
+                  ? ~0u
+                  : (1u << (uint32_t)options.size()) - 1;
+  if (options.size() > MAX_OPTIONS)
+    std::cout << "ERROR::SHADER_VARIANTS::TOO_MANY_OPTIONS\n"
+              << vertexPath << " " << fragmentPath << std::endl;
+}
+
+std::vector<std::string> ShaderVariants::defines(uint32_t key) const {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < options.size() && i < MAX_OPTIONS; i++)
+    if (key & (1u << i))
+      names.push_back(options[i]);
+  return names;
+}
+
+Shader &ShaderVariants::get(uint32_t key) {
+  // bits without an option would only duplicate a variant
+  key &= validBits;
+  std::unique_ptr<Shader> &variant = variants[key];
+  if (!variant)
+    variant.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(),
+                             compiler, defines(key)));
+  return *variant;
+}
@@ -0,0 +1,93 @@
+#include "shaderWatcher.h"
+#include "shader.h"
+#include "shaderCompiler.h"
+#include "shaderPreprocessor.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderWatcher::ShaderWatcher(ShaderCompiler &compiler) : compiler(compiler) {
+#ifdef __linux__
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher() {
+#ifdef __linux__
+  // closing the descriptor drops every watch
+  if (fd >= 0)
+    close(fd);
+#endif
+}
+
+void ShaderWatcher::add(Shader &shader) {
+  if (fd < 0)
+    return;
+  watch(shader);
+}
+
+void ShaderWatcher::watch(Shader &shader) {
+#ifdef __linux__
+  for (const std::string &source : shader.sourcePaths()) {
+    // includes are in sourcePaths as well, so they are watched in the same
+    // directory the preprocessor reads them from
+    const std::string path = shaderPreprocessor().diskPath(source);
+    size_t slash = path.find_last_of('/');
+    std::string directory =
+        slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    std::string name =
+        slash == std::string::npos ? path : path.substr(slash + 1);
+    // watching a directory twice returns the same descriptor
+    int descriptor =
+        inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (descriptor < 0) {
+      std::cout << "ERROR::SHADER_WATCHER::WATCH_FAILED\n"
+                << directory << std::endl;
+      continue;
+    }
+    bool known = false;
+    for (const File &file : files)
+      known = known || (file.watch == descriptor && file.name == name &&
+                        file.shader == &shader);
+    if (!known)
+      files.push_back(File{descriptor, name, &shader});
+  }
+#endif
+}
+
+void ShaderWatcher::update() {
+  if (fd < 0)
+    return;
+
+#ifdef __linux__
+  alignas(inotify_event) char buffer[4096];
+  ssize_t bytes;
+  while ((bytes = read(fd, buffer, sizeof(buffer))) > 0) {
+    for (ssize_t offset = 0; offset < bytes;) {
+      const inotify_event *event = (const inotify_event *)(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+      if (event->len == 0)
+        continue;
+      for (const File &file : files)
+        if (file.watch == event->wd && file.name == event->name &&
+            std::find(changed.begin(), changed.end(), file.shader) ==
+                changed.end())
+          changed.push_back(file.shader);
+    }
+  }
+#endif
+
+  // one rebuild per shader however many of its files were saved. The
+  // reload rereads the sources, so an #include added by the edit is
+  // watched from here on
+  for (Shader *shader : changed) {
+    compiler.reload(*shader);
+    watch(*shader);
+  }
+  changed.clear();
+}
@@ -0,0 +1,108 @@
+#include "streamBuffer.h"
+#include "errorReporting.h"
+#include "glExtensions.h"
+#include "glState.h"
+
+#include <chrono>
+#include <string>
+
+StreamBuffer::StreamBuffer(GLenum target, size_t bytesPerFrame)
+    : target(target), bytesPerRegion(bytesPerFrame) {
+  glGenBuffers(1, &name);
+  glState().bindBuffer(target, name);
+
+  if (GLEXT_ARB_buffer_storage) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(target, bytesPerRegion * FRAMES, NULL, flags);
+    mapped = (unsigned char *)glMapBufferRange(target, 0,
+                                               bytesPerRegion * FRAMES, flags);
+    if (!mapped)
+      reportError("Persistent stream buffer mapping failed");
+  }
+  if (!mapped) {
+    // immutable storage cannot be orphaned, start over with a new name
+    if (GLEXT_ARB_buffer_storage) {
+      glDeleteBuffers(1, &name);
+      glState().invalidate();
+      glGenBuffers(1, &name);
+      glState().bindBuffer(target, name);
+    }
+    glBufferData(target, bytesPerRegion, NULL, GL_STREAM_DRAW);
+    staging.resize(bytesPerRegion);
+  }
+}
+
+StreamBuffer::~StreamBuffer() {
+  for (GLsync fence : fences)
+    if (fence)
+      glDeleteSync(fence);
+  if (mapped) {
+    glState().bindBuffer(target, name);
+    glUnmapBuffer(target);
+  }
+  glDeleteBuffers(1, &name);
+  glState().invalidate();
+}
+
+void StreamBuffer::beginFrame() {
+  head = 0;
+  flushed = 0;
+
+  GLsync &fence = fences[region];
+  if (!fence)
+    return;
+
+  // a finished fence costs nothing, anything else is a CPU stall
+  GLenum status = glClientWaitSync(fence, 0, 0);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    auto start = std::chrono::steady_clock::now();
+    status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                              GL_TIMEOUT_IGNORED);
+    double waitedMs = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    if (stallStats.stalls++ == 0)
+      reportError(("Stream buffer stalled " + std::to_string(waitedMs) +
+                   " ms waiting on the GPU")
+                      .c_str());
+    stallStats.stallMs += waitedMs;
+  }
+  if (status == GL_WAIT_FAILED)
+    reportError("Stream buffer fence wait failed");
+  glDeleteSync(fence);
+  fence = NULL;
+}
+
+void *StreamBuffer::allocate(size_t bytes, size_t alignment, size_t &offset) {
+  size_t start = (head + alignment - 1) & ~(alignment - 1);
+  if (start + bytes > bytesPerRegion)
+    return nullptr;
+  head = start + bytes;
+
+  if (mapped) {
+    offset = region * bytesPerRegion + start;
+    return mapped + offset;
+  }
+  offset = start;
+  return staging.data() + start;
+}
+
+void StreamBuffer::flush() {
+  if (mapped || head == flushed)
+    return;
+
+  glState().bindBuffer(target, name);
+  // the first upload of a frame orphans, so it never waits on last frame
+  if (flushed == 0)
+    glBufferData(target, bytesPerRegion, NULL, GL_STREAM_DRAW);
+  glBufferSubData(target, flushed, head - flushed, staging.data() + flushed);
+  flushed = head;
+}
+
+void StreamBuffer::endFrame() {
+  if (!mapped)
+    return;
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  region = (region + 1) % FRAMES;
+}
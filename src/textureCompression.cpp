@@ -0,0 +1,856 @@
+#include "textureCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// 16 texels of a 4x4 block in row order, RGBA
+typedef uint8_t Block[16][4];
+
+const uint8_t INVALID_BLOCK[4] = {255, 0, 255, 255};
+
+int clampByte(int value) { return std::min(255, std::max(0, value)); }
+
+int roundClamp(float value, int maximum) {
+  return std::min(maximum, std::max(0, (int)std::lround(value)));
+}
+
+void fetchBlock(const Image &image, uint32_t blockX, uint32_t blockY,
+                Block &texels) {
+  for (uint32_t y = 0; y < 4; y++) {
+    uint32_t sourceY = std::min(blockY * 4 + y, image.height - 1);
+    for (uint32_t x = 0; x < 4; x++) {
+      uint32_t sourceX = std::min(blockX * 4 + x, image.width - 1);
+      const uint8_t *texel =
+          &image.rgba[((size_t)sourceY * image.width + sourceX) * 4];
+      std::memcpy(texels[y * 4 + x], texel, 4);
+    }
+  }
+}
+
+void storeBlock(const Block &texels, uint32_t blockX, uint32_t blockY,
+                Image &image) {
+  for (uint32_t y = 0; y < 4 && blockY * 4 + y < image.height; y++)
+    for (uint32_t x = 0; x < 4 && blockX * 4 + x < image.width; x++)
+      std::memcpy(&image.rgba[((size_t)(blockY * 4 + y) * image.width +
+                               blockX * 4 + x) *
+                              4],
+                  texels[y * 4 + x], 4);
+}
+
+void fillBlock(Block &texels, const uint8_t color[4]) {
+  for (int i = 0; i < 16; i++)
+    std::memcpy(texels[i], color, 4);
+}
+
+// Endpoints spanning the texels along their principal axis, found with a
+// few power iterations on the covariance of the first channels
+void fitLine(const Block &texels, int channels, float low[4], float high[4]) {
+  float mean[4] = {};
+  for (int i = 0; i < 16; i++)
+    for (int c = 0; c < channels; c++)
+      mean[c] += texels[i][c] / 16.0f;
+
+  float covariance[4][4] = {};
+  for (int i = 0; i < 16; i++)
+    for (int a = 0; a < channels; a++)
+      for (int b = 0; b < channels; b++)
+        covariance[a][b] +=
+            (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+
+  float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[4] = {};
+    float length = 0.0f;
+    for (int a = 0; a < channels; a++) {
+      for (int b = 0; b < channels; b++)
+        next[a] += covariance[a][b] * axis[b];
+      length = std::max(length, std::fabs(next[a]));
+    }
+    // a flat block has no axis, both endpoints become the mean
+    if (length < 1e-6f) {
+      std::fill(axis, axis + 4, 0.0f);
+      break;
+    }
+    for (int a = 0; a < channels; a++)
+      axis[a] = next[a] / length;
+  }
+
+  float lengthSquared = 0.0f;
+  for (int c = 0; c < channels; c++)
+    lengthSquared += axis[c] * axis[c];
+  float minimum = 0.0f, maximum = 0.0f;
+  if (lengthSquared > 0.0f) {
+    minimum = std::numeric_limits<float>::max();
+    maximum = -minimum;
+    for (int i = 0; i < 16; i++) {
+      float t = 0.0f;
+      for (int c = 0; c < channels; c++)
+        t += (texels[i][c] - mean[c]) * axis[c];
+      t /= lengthSquared;
+      minimum = std::min(minimum, t);
+      maximum = std::max(maximum, t);
+    }
+  }
+  for (int c = 0; c < channels; c++) {
+    low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minimum));
+    high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maximum));
+  }
+}
+
+int squaredError(const uint8_t *a, const int *b, int channels) {
+  int error = 0;
+  for (int c = 0; c < channels; c++)
+    error += (a[c] - b[c]) * (a[c] - b[c]);
+  return error;
+}
+
+// BC1 / BC3 colour
+
+uint16_t pack565(const float color[3]) {
+  return (uint16_t)(roundClamp(color[0] * 31.0f / 255.0f, 31) << 11 |
+                    roundClamp(color[1] * 63.0f / 255.0f, 63) << 5 |
+                    roundClamp(color[2] * 31.0f / 255.0f, 31));
+}
+
+void unpack565(uint16_t packed, int color[4]) {
+  int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+  color[0] = r << 3 | r >> 2;
+  color[1] = g << 2 | g >> 4;
+  color[2] = b << 3 | b >> 2;
+  color[3] = 255;
+}
+
+// the three colour mode with transparent black only exists for c0 <= c1
+// in BC1; BC3 colour blocks always use four colours
+void colorPalette(uint16_t c0, uint16_t c1, bool allowThreeColor,
+                  int palette[4][4]) {
+  unpack565(c0, palette[0]);
+  unpack565(c1, palette[1]);
+  for (int c = 0; c < 3; c++) {
+    if (c0 > c1 || !allowThreeColor) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+  palette[2][3] = 255;
+  palette[3][3] = c0 > c1 || !allowThreeColor ? 255 : 0;
+}
+
+// four colour indices for the endpoints, returns the squared error
+int colorIndices(const Block &texels, uint16_t &c0, uint16_t &c1,
+                 uint32_t &indices) {
+  if (c0 < c1)
+    std::swap(c0, c1);
+  int palette[4][4];
+  colorPalette(c0, c1, false, palette);
+
+  int error = 0;
+  indices = 0;
+  for (int i = 0; i < 16; i++) {
+    int best = 0;
+    int bestError = std::numeric_limits<int>::max();
+    // equal endpoints only have one colour, any index but 0 would switch
+    // BC1 into three colour mode
+    for (int p = 0; p < (c0 == c1 ? 1 : 4); p++) {
+      int candidate = squaredError(texels[i], palette[p], 3);
+      if (candidate < bestError) {
+        bestError = candidate;
+        best = p;
+      }
+    }
+    indices |= (uint32_t)best << (i * 2);
+    error += bestError;
+  }
+  return error;
+}
+
+void encodeColorBlock(const Block &texels, uint8_t *out) {
+  float low[4], high[4];
+  fitLine(texels, 3, low, high);
+  uint16_t c0 = pack565(high), c1 = pack565(low);
+  uint32_t indices;
+  int error = colorIndices(texels, c0, c1, indices);
+
+  // least squares endpoints for the indices of the first fit
+  static const float WEIGHT[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[3] = {}, bx[3] = {};
+  for (int i = 0; i < 16; i++) {
+    float a = WEIGHT[(indices >> (i * 2)) & 3], b = 1.0f - a;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < 3; c++) {
+      ax[c] += a * texels[i][c];
+      bx[c] += b * texels[i][c];
+    }
+  }
+  float determinant = aa * bb - ab * ab;
+  if (std::fabs(determinant) > 1e-6f) {
+    float first[3], second[3];
+    for (int c = 0; c < 3; c++) {
+      first[c] = std::min(
+          255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) / determinant));
+      second[c] = std::min(
+          255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) / determinant));
+    }
+    uint16_t r0 = pack565(first), r1 = pack565(second);
+    uint32_t refinedIndices;
+    if (colorIndices(texels, r0, r1, refinedIndices) < error) {
+      c0 = r0;
+      c1 = r1;
+      indices = refinedIndices;
+    }
+  }
+
+  out[0] = (uint8_t)c0;
+  out[1] = (uint8_t)(c0 >> 8);
+  out[2] = (uint8_t)c1;
+  out[3] = (uint8_t)(c1 >> 8);
+  for (int i = 0; i < 4; i++)
+    out[4 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+void decodeColorBlock(const uint8_t *in, bool allowThreeColor,
+                      Block &texels) {
+  uint16_t c0 = (uint16_t)(in[0] | in[1] << 8);
+  uint16_t c1 = (uint16_t)(in[2] | in[3] << 8);
+  int palette[4][4];
+  colorPalette(c0, c1, allowThreeColor, palette);
+  for (int i = 0; i < 16; i++) {
+    int index = (in[4 + i / 4] >> ((i % 4) * 2)) & 3;
+    for (int c = 0; c < 4; c++)
+      texels[i][c] = (uint8_t)palette[index][c];
+  }
+}
+
+// BC3 alpha
+
+void alphaPalette(int a0, int a1, int palette[8]) {
+  palette[0] = a0;
+  palette[1] = a1;
+  if (a0 > a1) {
+    for (int i = 2; i < 8; i++)
+      palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+  } else {
+    for (int i = 2; i < 6; i++)
+      palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+void encodeAlphaBlock(const Block &texels, uint8_t *out) {
+  int a0 = 0, a1 = 255;
+  for (int i = 0; i < 16; i++) {
+    a0 = std::max(a0, (int)texels[i][3]);
+    a1 = std::min(a1, (int)texels[i][3]);
+  }
+  int palette[8];
+  alphaPalette(a0, a1, palette);
+
+  uint64_t indices = 0;
+  for (int i = 0; i < 16 && a0 != a1; i++) {
+    int best = 0;
+    for (int p = 1; p < 8; p++)
+      if (std::abs(palette[p] - texels[i][3]) <
+          std::abs(palette[best] - texels[i][3]))
+        best = p;
+    indices |= (uint64_t)best << (i * 3);
+  }
+  out[0] = (uint8_t)a0;
+  out[1] = (uint8_t)a1;
+  for (int i = 0; i < 6; i++)
+    out[2 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+void decodeAlphaBlock(const uint8_t *in, Block &texels) {
+  int palette[8];
+  alphaPalette(in[0], in[1], palette);
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; i++)
+    indices |= (uint64_t)in[2 + i] << (i * 8);
+  for (int i = 0; i < 16; i++)
+    texels[i][3] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+}
+
+// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a shared low bit
+// per endpoint, 4 bit indices
+
+const int BC7_WEIGHTS[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                             34, 38, 43, 47, 51, 55, 60, 64};
+
+struct BitWriter {
+  uint8_t *out;
+  unsigned int position = 0;
+
+  void write(uint32_t value, unsigned int bits) {
+    for (unsigned int i = 0; i < bits; i++, position++)
+      if ((value >> i) & 1)
+        out[position >> 3] |= (uint8_t)(1 << (position & 7));
+  }
+};
+
+struct BitReader {
+  const uint8_t *in;
+  unsigned int position = 0;
+
+  uint32_t read(unsigned int bits) {
+    uint32_t value = 0;
+    for (unsigned int i = 0; i < bits; i++, position++)
+      value |= (uint32_t)((in[position >> 3] >> (position & 7)) & 1) << i;
+    return value;
+  }
+};
+
+// texel indices for the endpoints, returns the squared error
+int bc7Indices(const Block &texels, const int e0[4], const int e1[4],
+               uint8_t indices[16]) {
+  int palette[16][4];
+  for (int w = 0; w < 16; w++)
+    for (int c = 0; c < 4; c++)
+      palette[w][c] =
+          ((64 - BC7_WEIGHTS[w]) * e0[c] + BC7_WEIGHTS[w] * e1[c] + 32) >> 6;
+
+  int error = 0;
+  for (int i = 0; i < 16; i++) {
+    int bestError = std::numeric_limits<int>::max();
+    for (int w = 0; w < 16; w++) {
+      int candidate = squaredError(texels[i], palette[w], 4);
+      if (candidate < bestError) {
+        bestError = candidate;
+        indices[i] = (uint8_t)w;
+      }
+    }
+    error += bestError;
+  }
+  return error;
+}
+
+void encodeBc7Block(const Block &texels, uint8_t *out) {
+  float low[4], high[4];
+  fitLine(texels, 4, low, high);
+
+  // every combination of the two low bits
+  int bestError = std::numeric_limits<int>::max();
+  int q0[4], q1[4], p0 = 0, p1 = 0;
+  uint8_t indices[16];
+  for (int bits = 0; bits < 4; bits++) {
+    int b0 = bits & 1, b1 = bits >> 1;
+    int c0[4], c1[4], e0[4], e1[4];
+    for (int c = 0; c < 4; c++) {
+      c0[c] = roundClamp((low[c] - b0) / 2.0f, 127);
+      c1[c] = roundClamp((high[c] - b1) / 2.0f, 127);
+      e0[c] = c0[c] << 1 | b0;
+      e1[c] = c1[c] << 1 | b1;
+    }
+    uint8_t candidate[16];
+    int error = bc7Indices(texels, e0, e1, candidate);
+    if (error < bestError) {
+      bestError = error;
+      std::copy(c0, c0 + 4, q0);
+      std::copy(c1, c1 + 4, q1);
+      p0 = b0;
+      p1 = b1;
+      std::copy(candidate, candidate + 16, indices);
+    }
+  }
+
+  // the first index is stored without its top bit, which must be clear
+  if (indices[0] & 8) {
+    std::swap(q0, q1);
+    std::swap(p0, p1);
+    for (uint8_t &index : indices)
+      index = (uint8_t)(15 - index);
+  }
+
+  std::memset(out, 0, 16);
+  BitWriter writer{out};
+  writer.write(1 << 6, 7);
+  for (int c = 0; c < 4; c++) {
+    writer.write(q0[c], 7);
+    writer.write(q1[c], 7);
+  }
+  writer.write(p0, 1);
+  writer.write(p1, 1);
+  writer.write(indices[0], 3);
+  for (int i = 1; i < 16; i++)
+    writer.write(indices[i], 4);
+}
+
+void decodeBc7Block(const uint8_t *in, Block &texels) {
+  BitReader reader{in};
+  if (reader.read(7) != 1 << 6) {
+    fillBlock(texels, INVALID_BLOCK);
+    return;
+  }
+  int e0[4], e1[4];
+  for (int c = 0; c < 4; c++) {
+    e0[c] = (int)reader.read(7) << 1;
+    e1[c] = (int)reader.read(7) << 1;
+  }
+  int p0 = (int)reader.read(1), p1 = (int)reader.read(1);
+  for (int c = 0; c < 4; c++) {
+    e0[c] |= p0;
+    e1[c] |= p1;
+  }
+  for (int i = 0; i < 16; i++) {
+    int w = BC7_WEIGHTS[reader.read(i == 0 ? 3 : 4)];
+    for (int c = 0; c < 4; c++)
+      texels[i][c] = (uint8_t)(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+  }
+}
+
+// ETC1 compatible ETC2 colour: two half blocks, each a base colour plus
+// one of eight modifier tables. Texel indices run down the columns
+
+const int ETC_MODIFIERS[8][2] = {{2, 8},   {5, 17},  {9, 29},  {13, 42},
+                                 {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+
+// 2 bit index: +small, +large, -small, -large
+int etcModifier(int table, int index) {
+  int modifier = ETC_MODIFIERS[table][index & 1];
+  return index & 2 ? -modifier : modifier;
+}
+
+bool inHalf(int texel, bool flip, int half) {
+  int x = texel % 4, y = texel / 4;
+  return ((flip ? y : x) >= 2) == (half == 1);
+}
+
+// best table and indices for one half around base, returns the error
+int etcHalf(const Block &texels, bool flip, int half, const int base[3],
+            int &table, uint8_t indices[16]) {
+  int bestError = std::numeric_limits<int>::max();
+  for (int t = 0; t < 8; t++) {
+    int error = 0;
+    uint8_t candidate[16] = {};
+    for (int i = 0; i < 16; i++) {
+      if (!inHalf(i, flip, half))
+        continue;
+      int texelError = std::numeric_limits<int>::max();
+      for (int index = 0; index < 4; index++) {
+        int color[3];
+        for (int c = 0; c < 3; c++)
+          color[c] = clampByte(base[c] + etcModifier(t, index));
+        int e = squaredError(texels[i], color, 3);
+        if (e < texelError) {
+          texelError = e;
+          candidate[i] = (uint8_t)index;
+        }
+      }
+      error += texelError;
+    }
+    if (error < bestError) {
+      bestError = error;
+      table = t;
+      for (int i = 0; i < 16; i++)
+        if (inHalf(i, flip, half))
+          indices[i] = candidate[i];
+    }
+  }
+  return bestError;
+}
+
+void encodeEtcColorBlock(const Block &texels, uint8_t *out) {
+  uint64_t best = 0;
+  int bestError = std::numeric_limits<int>::max();
+
+  for (int flip = 0; flip < 2; flip++) {
+    float average[2][3] = {};
+    for (int i = 0; i < 16; i++)
+      for (int c = 0; c < 3; c++)
+        average[inHalf(i, flip, 1)][c] += texels[i][c] / 8.0f;
+
+    for (int differential = 0; differential < 2; differential++) {
+      int quantized[2][3], base[2][3];
+      for (int c = 0; c < 3; c++) {
+        if (differential) {
+          quantized[0][c] = roundClamp(average[0][c] * 31.0f / 255.0f, 31);
+          quantized[1][c] = roundClamp(average[1][c] * 31.0f / 255.0f, 31);
+          // the second colour is stored as a 3 bit signed difference
+          int delta = std::min(3, std::max(-4, quantized[1][c] -
+                                                   quantized[0][c]));
+          quantized[1][c] = quantized[0][c] + delta;
+          for (int h = 0; h < 2; h++)
+            base[h][c] = quantized[h][c] << 3 | quantized[h][c] >> 2;
+        } else {
+          for (int h = 0; h < 2; h++) {
+            quantized[h][c] = roundClamp(average[h][c] * 15.0f / 255.0f, 15);
+            base[h][c] = quantized[h][c] << 4 | quantized[h][c];
+          }
+        }
+      }
+
+      int tables[2];
+      uint8_t indices[16];
+      int error = etcHalf(texels, flip, 0, base[0], tables[0], indices) +
+                  etcHalf(texels, flip, 1, base[1], tables[1], indices);
+      if (error >= bestError)
+        continue;
+      bestError = error;
+
+      uint64_t bits = 0;
+      for (int c = 0; c < 3; c++) {
+        int shift = 56 - c * 8;
+        if (differential)
+          bits |= (uint64_t)quantized[0][c] << (shift + 3) |
+                  (uint64_t)((quantized[1][c] - quantized[0][c]) & 7)
+                      << shift;
+        else
+          bits |= (uint64_t)quantized[0][c] << (shift + 4) |
+                  (uint64_t)quantized[1][c] << shift;
+      }
+      bits |= (uint64_t)tables[0] << 37 | (uint64_t)tables[1] << 34 |
+              (uint64_t)differential << 33 | (uint64_t)flip << 32;
+      for (int i = 0; i < 16; i++) {
+        int position = (i % 4) * 4 + i / 4;
+        bits |= (uint64_t)(indices[i] >> 1) << (16 + position) |
+                (uint64_t)(indices[i] & 1) << position;
+      }
+      best = bits;
+    }
+  }
+  for (int i = 0; i < 8; i++)
+    out[i] = (uint8_t)(best >> (56 - i * 8));
+}
+
+uint64_t readBigEndian(const uint8_t *in) {
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; i++)
+    bits = bits << 8 | in[i];
+  return bits;
+}
+
+void decodeEtcColorBlock(const uint8_t *in, Block &texels) {
+  uint64_t bits = readBigEndian(in);
+  bool differential = (bits >> 33) & 1;
+  bool flip = (bits >> 32) & 1;
+
+  int base[2][3];
+  for (int c = 0; c < 3; c++) {
+    int shift = 56 - c * 8;
+    if (differential) {
+      int first = (int)(bits >> (shift + 3)) & 31;
+      int delta = (int)(bits >> shift) & 7;
+      int second = first + (delta >= 4 ? delta - 8 : delta);
+      // an overflowing difference selects the ETC2 T, H or planar modes
+      if (second < 0 || second > 31) {
+        fillBlock(texels, INVALID_BLOCK);
+        return;
+      }
+      base[0][c] = first << 3 | first >> 2;
+      base[1][c] = second << 3 | second >> 2;
+    } else {
+      int first = (int)(bits >> (shift + 4)) & 15;
+      int second = (int)(bits >> shift) & 15;
+      base[0][c] = first << 4 | first;
+      base[1][c] = second << 4 | second;
+    }
+  }
+
+  int tables[2] = {(int)(bits >> 37) & 7, (int)(bits >> 34) & 7};
+  for (int i = 0; i < 16; i++) {
+    int position = (i % 4) * 4 + i / 4;
+    int index = (int)((bits >> (16 + position)) & 1) << 1 |
+                (int)((bits >> position) & 1);
+    int half = inHalf(i, flip, 1);
+    for (int c = 0; c < 3; c++)
+      texels[i][c] =
+          (uint8_t)clampByte(base[half][c] + etcModifier(tables[half], index));
+    texels[i][3] = 255;
+  }
+}
+
+// ETC2 EAC alpha: base, multiplier and one of sixteen modifier tables
+
+const int EAC_MODIFIERS[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+// indices for one base, multiplier and table, returns the error
+int eacIndices(const Block &texels, int base, int multiplier, int table,
+               uint64_t &indices) {
+  int error = 0;
+  indices = 0;
+  for (int i = 0; i < 16; i++) {
+    int best = 0;
+    int bestError = std::numeric_limits<int>::max();
+    for (int index = 0; index < 8; index++) {
+      int value =
+          clampByte(base + EAC_MODIFIERS[table][index] * multiplier);
+      int e = (value - texels[i][3]) * (value - texels[i][3]);
+      if (e < bestError) {
+        bestError = e;
+        best = index;
+      }
+    }
+    int position = (i % 4) * 4 + i / 4;
+    indices |= (uint64_t)best << (45 - position * 3);
+    error += bestError;
+  }
+  return error;
+}
+
+void encodeEacAlphaBlock(const Block &texels, uint8_t *out) {
+  int minimum = 255, maximum = 0;
+  for (int i = 0; i < 16; i++) {
+    minimum = std::min(minimum, (int)texels[i][3]);
+    maximum = std::max(maximum, (int)texels[i][3]);
+  }
+
+  // only multipliers and bases that roughly span the block are tried
+  uint64_t best = 0;
+  int bestError = std::numeric_limits<int>::max();
+  for (int table = 0; table < 16 && bestError > 0; table++) {
+    int low = EAC_MODIFIERS[table][3], high = EAC_MODIFIERS[table][7];
+    int fit = (int)std::lround((float)(maximum - minimum) / (high - low));
+    for (int multiplier = std::max(1, fit - 1);
+         multiplier <= std::min(15, fit + 1); multiplier++) {
+      int center = (int)std::lround((minimum + maximum) / 2.0f -
+                                    (low + high) * multiplier / 2.0f);
+      for (int base = center - 1; base <= center + 1; base++) {
+        if (base < 0 || base > 255)
+          continue;
+        uint64_t indices;
+        int error = eacIndices(texels, base, multiplier, table, indices);
+        if (error < bestError) {
+          bestError = error;
+          best = (uint64_t)base << 56 | (uint64_t)multiplier << 52 |
+                 (uint64_t)table << 48 | indices;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < 8; i++)
+    out[i] = (uint8_t)(best >> (56 - i * 8));
+}
+
+void decodeEacAlphaBlock(const uint8_t *in, Block &texels) {
+  uint64_t bits = readBigEndian(in);
+  int base = (int)(bits >> 56);
+  int multiplier = (int)(bits >> 52) & 15;
+  int table = (int)(bits >> 48) & 15;
+  for (int i = 0; i < 16; i++) {
+    int position = (i % 4) * 4 + i / 4;
+    int index = (int)(bits >> (45 - position * 3)) & 7;
+    texels[i][3] = (uint8_t)clampByte(
+        base + EAC_MODIFIERS[table][index] * multiplier);
+  }
+}
+
+void encodeBlock(BlockFormat format, const Block &texels, uint8_t *out) {
+  switch (format) {
+  case BlockFormat::Bc1:
+    encodeColorBlock(texels, out);
+    break;
+  case BlockFormat::Bc3:
+    encodeAlphaBlock(texels, out);
+    encodeColorBlock(texels, out + 8);
+    break;
+  case BlockFormat::Bc7:
+    encodeBc7Block(texels, out);
+    break;
+  case BlockFormat::Etc2Rgb:
+    encodeEtcColorBlock(texels, out);
+    break;
+  case BlockFormat::Etc2Rgba:
+    encodeEacAlphaBlock(texels, out);
+    encodeEtcColorBlock(texels, out + 8);
+    break;
+  }
+}
+
+void decodeBlock(BlockFormat format, const uint8_t *in, Block &texels) {
+  switch (format) {
+  case BlockFormat::Bc1:
+    decodeColorBlock(in, true, texels);
+    break;
+  case BlockFormat::Bc3:
+    decodeColorBlock(in + 8, false, texels);
+    decodeAlphaBlock(in, texels);
+    break;
+  case BlockFormat::Bc7:
+    decodeBc7Block(in, texels);
+    break;
+  case BlockFormat::Etc2Rgb:
+    decodeEtcColorBlock(in, texels);
+    break;
+  case BlockFormat::Etc2Rgba:
+    decodeEtcColorBlock(in + 8, texels);
+    decodeEacAlphaBlock(in, texels);
+    break;
+  }
+}
+
+} // namespace
+
+const char *blockFormatName(BlockFormat format) {
+  switch (format) {
+  case BlockFormat::Bc1:
+    return "bc1";
+  case BlockFormat::Bc3:
+    return "bc3";
+  case BlockFormat::Bc7:
+    return "bc7";
+  case BlockFormat::Etc2Rgb:
+    return "etc2";
+  case BlockFormat::Etc2Rgba:
+    return "etc2a";
+  }
+  return "unknown";
+}
+
+bool parseBlockFormat(const char *name, BlockFormat &format) {
+  const BlockFormat formats[] = {BlockFormat::Bc1, BlockFormat::Bc3,
+                                 BlockFormat::Bc7, BlockFormat::Etc2Rgb,
+                                 BlockFormat::Etc2Rgba};
+  for (BlockFormat candidate : formats) {
+    if (std::strcmp(name, blockFormatName(candidate)) == 0) {
+      format = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t blockBytes(BlockFormat format) {
+  return format == BlockFormat::Bc1 || format == BlockFormat::Etc2Rgb ? 8
+                                                                      : 16;
+}
+
+bool blockFormatHasAlpha(BlockFormat format) {
+  return format == BlockFormat::Bc3 || format == BlockFormat::Bc7 ||
+         format == BlockFormat::Etc2Rgba;
+}
+
+uint32_t blockVkFormat(BlockFormat format) {
+  switch (format) {
+  case BlockFormat::Bc1:
+    return 131; // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+  case BlockFormat::Bc3:
+    return 137; // VK_FORMAT_BC3_UNORM_BLOCK
+  case BlockFormat::Bc7:
+    return 145; // VK_FORMAT_BC7_UNORM_BLOCK
+  case BlockFormat::Etc2Rgb:
+    return 147; // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+  case BlockFormat::Etc2Rgba:
+    return 151; // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+  }
+  return 0;
+}
+
+bool blockFormatFromVk(uint32_t vkFormat, BlockFormat &format) {
+  const BlockFormat formats[] = {BlockFormat::Bc1, BlockFormat::Bc3,
+                                 BlockFormat::Bc7, BlockFormat::Etc2Rgb,
+                                 BlockFormat::Etc2Rgba};
+  for (BlockFormat candidate : formats) {
+    if (blockVkFormat(candidate) == vkFormat) {
+      format = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t compressedSize(BlockFormat format, uint32_t width, uint32_t height) {
+  return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+Image downsample(const Image &image) {
+  Image half;
+  half.width = std::max(1u, image.width / 2);
+  half.height = std::max(1u, image.height / 2);
+  half.rgba.resize((size_t)half.width * half.height * 4);
+
+  for (uint32_t y = 0; y < half.height; y++) {
+    uint32_t y0 = std::min(y * 2, image.height - 1);
+    uint32_t y1 = std::min(y * 2 + 1, image.height - 1);
+    for (uint32_t x = 0; x < half.width; x++) {
+      uint32_t x0 = std::min(x * 2, image.width - 1);
+      uint32_t x1 = std::min(x * 2 + 1, image.width - 1);
+      for (int c = 0; c < 4; c++) {
+        int sum = image.rgba[((size_t)y0 * image.width + x0) * 4 + c] +
+                  image.rgba[((size_t)y0 * image.width + x1) * 4 + c] +
+                  image.rgba[((size_t)y1 * image.width + x0) * 4 + c] +
+                  image.rgba[((size_t)y1 * image.width + x1) * 4 + c];
+        half.rgba[((size_t)y * half.width + x) * 4 + c] =
+            (uint8_t)((sum + 2) / 4);
+      }
+    }
+  }
+  return half;
+}
+
+std::vector<Image> buildMipChain(const Image &image) {
+  std::vector<Image> levels;
+  levels.push_back(image);
+  while (levels.back().width > 1 || levels.back().height > 1)
+    levels.push_back(downsample(levels.back()));
+  return levels;
+}
+
+std::vector<uint8_t> compressImage(BlockFormat format, const Image &image) {
+  const uint32_t blocksX = (image.width + 3) / 4;
+  const uint32_t blocksY = (image.height + 3) / 4;
+  const size_t bytes = blockBytes(format);
+  std::vector<uint8_t> blocks((size_t)blocksX * blocksY * bytes);
+
+  Block texels;
+  for (uint32_t by = 0; by < blocksY; by++) {
+    for (uint32_t bx = 0; bx < blocksX; bx++) {
+      fetchBlock(image, bx, by, texels);
+      encodeBlock(format, texels, &blocks[((size_t)by * blocksX + bx) * bytes]);
+    }
+  }
+  return blocks;
+}
+
+Image decompressImage(BlockFormat format, const uint8_t *blocks,
+                      uint32_t width, uint32_t height) {
+  Image image;
+  image.width = width;
+  image.height = height;
+  image.rgba.resize((size_t)width * height * 4);
+
+  const uint32_t blocksX = (width + 3) / 4;
+  const uint32_t blocksY = (height + 3) / 4;
+  const size_t bytes = blockBytes(format);
+  Block texels;
+  for (uint32_t by = 0; by < blocksY; by++) {
+    for (uint32_t bx = 0; bx < blocksX; bx++) {
+      decodeBlock(format, &blocks[((size_t)by * blocksX + bx) * bytes],
+                  texels);
+      storeBlock(texels, bx, by, image);
+    }
+  }
+  return image;
+}
+
+double psnr(const Image &a, const Image &b, unsigned int channels) {
+  double sum = 0.0;
+  size_t texels = (size_t)a.width * a.height;
+  for (size_t i = 0; i < texels; i++) {
+    for (unsigned int c = 0; c < channels; c++) {
+      double difference = (double)a.rgba[i * 4 + c] - b.rgba[i * 4 + c];
+      sum += difference * difference;
+    }
+  }
+  if (sum == 0.0)
+    return std::numeric_limits<double>::infinity();
+  double meanSquared = sum / (double)(texels * channels);
+  return 10.0 * std::log10(255.0 * 255.0 / meanSquared);
+}
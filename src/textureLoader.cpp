@@ -0,0 +1,333 @@
+#include "textureLoader.h"
+#include "assetPack.h"
+#include "glExtensions.h"
+#include "glState.h"
+#include "ktx2.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+struct TextureLoader::Baked {
+  Ktx2View view;
+  // empty when the view points into the mapping
+  std::vector<uint8_t> bytes;
+};
+
+namespace {
+
+GLenum formatForChannels(int channels) {
+  switch (channels) {
+  case 1:
+    return GL_RED;
+  case 2:
+    return GL_RG;
+  case 3:
+    return GL_RGB;
+  default:
+    return GL_RGBA;
+  }
+}
+
+bool samplesFormat(BlockFormat format) {
+  switch (format) {
+  case BlockFormat::Bc1:
+  case BlockFormat::Bc3:
+    return GLEXT_EXT_texture_compression_s3tc;
+  case BlockFormat::Bc7:
+    return GLEXT_ARB_texture_compression_bptc;
+  case BlockFormat::Etc2Rgb:
+  case BlockFormat::Etc2Rgba:
+    return GLEXT_ARB_ES3_compatibility;
+  }
+  return false;
+}
+
+GLenum compressedFormat(BlockFormat format) {
+  switch (format) {
+  case BlockFormat::Bc1:
+    return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  case BlockFormat::Bc3:
+    return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  case BlockFormat::Bc7:
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+  case BlockFormat::Etc2Rgb:
+    return GL_COMPRESSED_RGB8_ETC2;
+  case BlockFormat::Etc2Rgba:
+    return GL_COMPRESSED_RGBA8_ETC2_EAC;
+  }
+  return GL_NONE;
+}
+
+// the best baked version of path the context can sample, empty if none.
+// ETC2 comes last, desktop drivers often decompress it on upload
+std::string findBaked(const std::string &path) {
+  const BlockFormat PREFERENCE[] = {BlockFormat::Bc7, BlockFormat::Bc3,
+                                    BlockFormat::Bc1, BlockFormat::Etc2Rgba,
+                                    BlockFormat::Etc2Rgb};
+  // strip the extension, but not a dot in a directory name
+  std::string stem = path;
+  size_t dot = path.rfind('.');
+  size_t slash = path.find_last_of("/\\");
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+    stem.resize(dot);
+  for (BlockFormat format : PREFERENCE) {
+    if (!samplesFormat(format))
+      continue;
+    std::string candidate = stem + "." + blockFormatName(format) + ".ktx2";
+    if (assetPack().contains(candidate) || std::ifstream(candidate))
+      return candidate;
+  }
+  return std::string();
+}
+
+} // namespace
+
+TextureLoader::TextureLoader(unsigned int workerCount) {
+  if (workerCount == 0)
+    workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+  glGenBuffers(PBO_COUNT, pbos);
+
+  workers.reserve(workerCount);
+  for (unsigned int i = 0; i < workerCount; i++)
+    workers.emplace_back(&TextureLoader::workerLoop, this);
+}
+
+TextureLoader::~TextureLoader() {
+  {
+    std::lock_guard<std::mutex> lock(jobMutex);
+    stopping = true;
+    jobs.clear();
+  }
+  jobReady.notify_all();
+  for (std::thread &worker : workers)
+    worker.join();
+
+  // drop anything decoded but never uploaded
+  collectCompleted();
+  for (Decoded *image : ready) {
+    stbi_image_free(image->pixels);
+    delete image;
+  }
+
+  glDeleteBuffers(PBO_COUNT, pbos);
+  glState().invalidate();
+}
+
+unsigned int TextureLoader::load(const std::string &path,
+                                 bool flipVertically) {
+  unsigned int texture;
+  glGenTextures(1, &texture);
+  glState().bindTexture(GL_TEXTURE_2D, texture);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // placeholder until the real image arrives
+  const unsigned char grey[4] = {128, 128, 128, 255};
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               grey);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  {
+    std::lock_guard<std::mutex> lock(jobMutex);
+    jobs.push_back(Job{texture, path, flipVertically, findBaked(path)});
+  }
+  jobReady.notify_one();
+  pendingCount++;
+
+  return texture;
+}
+
+void TextureLoader::workerLoop() {
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(jobMutex);
+      jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+      if (stopping)
+        return;
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+
+    Decoded *image = new Decoded{job.texture, std::move(job.path), NULL, 0,
+                                 0,           0,                   NULL,
+                                 nullptr};
+
+    // compressed rows cannot be flipped here, so the file has to have been
+    // baked in the orientation asked for
+    std::vector<uint8_t> scratch;
+    size_t size = 0;
+    if (!job.bakedPath.empty()) {
+      std::unique_ptr<Baked> baked(new Baked);
+      const uint8_t *packed = assetPack().bytes(job.bakedPath, scratch, size);
+      // the pack stores KTX2 uncompressed, so normally nothing is copied;
+      // moving the scratch keeps the view's pointers valid otherwise
+      if (packed && packed == scratch.data())
+        baked->bytes.swap(scratch);
+      bool read =
+          packed ? parseKtx2(packed, size, job.bakedPath, baked->view)
+                 : readKtx2(job.bakedPath, baked->bytes, baked->view);
+      if (read && baked->view.orientation == (job.flip ? "ru" : "rd")) {
+        image->width = (int)baked->view.width;
+        image->height = (int)baked->view.height;
+        image->channels = blockFormatHasAlpha(baked->view.format) ? 4 : 3;
+        image->compressed = std::move(baked);
+      }
+    }
+    // packed images decode straight from the mapping
+    if (!image->compressed) {
+      stbi_set_flip_vertically_on_load_thread(job.flip);
+      const uint8_t *packed = assetPack().bytes(image->path, scratch, size);
+      if (packed)
+        image->pixels = stbi_load_from_memory(
+            packed, (int)size, &image->width, &image->height,
+            &image->channels, 0);
+      else
+        image->pixels = stbi_load(image->path.c_str(), &image->width,
+                                  &image->height, &image->channels, 0);
+    }
+
+    // push onto the completed stack
+    Decoded *head = completed.load(std::memory_order_relaxed);
+    do {
+      image->next = head;
+    } while (!completed.compare_exchange_weak(head, image,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+  }
+}
+
+void TextureLoader::collectCompleted() {
+  Decoded *head = completed.exchange(nullptr, std::memory_order_acquire);
+  if (!head)
+    return;
+
+  // the stack is newest first, append it to ready oldest first
+  size_t first = ready.size();
+  for (; head; head = head->next)
+    ready.push_back(head);
+  std::reverse(ready.begin() + first, ready.end());
+}
+
+unsigned int TextureLoader::update(size_t maxUploadBytes) {
+  collectCompleted();
+
+  unsigned int uploaded = 0;
+  size_t uploadedBytes = 0;
+  size_t i = 0;
+  for (; i < ready.size(); i++) {
+    Decoded *image = ready[i];
+    size_t bytes = (size_t)image->width * image->height * image->channels;
+    if (image->compressed) {
+      bytes = 0;
+      for (const Ktx2Level &level : image->compressed->view.levels)
+        bytes += level.size;
+    }
+    // always upload at least one image so big ones cannot starve
+    if (maxUploadBytes && uploaded > 0 &&
+        uploadedBytes + bytes > maxUploadBytes)
+      break;
+
+    if (image->compressed) {
+      uploadCompressed(*image);
+    } else if (image->pixels) {
+      upload(*image);
+      stbi_image_free(image->pixels);
+    } else {
+      std::cout << "Failed to load texture " << image->path << std::endl;
+    }
+    delete image;
+
+    uploaded++;
+    uploadedBytes += bytes;
+    pendingCount--;
+  }
+  ready.erase(ready.begin(), ready.begin() + i);
+
+  return uploaded;
+}
+
+void TextureLoader::upload(const Decoded &image) {
+  GLenum format = formatForChannels(image.channels);
+  GLsizeiptr size = (GLsizeiptr)image.width * image.height * image.channels;
+
+  // orphan the buffer so the driver never waits on a previous upload
+  glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+  nextPbo = (nextPbo + 1) % PBO_COUNT;
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+  void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                  GL_MAP_WRITE_BIT |
+                                      GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (mapped) {
+    std::memcpy(mapped, image.pixels, size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  } else {
+    // fall back to a plain client memory upload
+    glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  glState().bindTexture(GL_TEXTURE_2D, image.texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format,
+               GL_UNSIGNED_BYTE, mapped ? NULL : image.pixels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void TextureLoader::uploadCompressed(const Decoded &image) {
+  const Ktx2View &baked = image.compressed->view;
+  GLsizeiptr size = 0;
+  for (const Ktx2Level &level : baked.levels)
+    size += (GLsizeiptr)level.size;
+
+  // every level goes through one orphaned pixel unpack buffer
+  glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+  nextPbo = (nextPbo + 1) % PBO_COUNT;
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+  unsigned char *mapped = (unsigned char *)glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (mapped) {
+    size_t offset = 0;
+    for (const Ktx2Level &level : baked.levels) {
+      std::memcpy(mapped + offset, level.data, level.size);
+      offset += level.size;
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  } else {
+    glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  glState().bindTexture(GL_TEXTURE_2D, image.texture);
+  const GLenum format = compressedFormat(baked.format);
+  size_t offset = 0;
+  for (size_t level = 0; level < baked.levels.size(); level++) {
+    const Ktx2Level &data = baked.levels[level];
+    GLsizei width = std::max(1, image.width >> level);
+    GLsizei height = std::max(1, image.height >> level);
+    glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, format, width,
+                           height, 0, (GLsizei)data.size,
+                           mapped ? (const void *)offset : data.data);
+    offset += data.size;
+  }
+  // the mip chain was built offline, nothing to generate
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  (GLint)baked.levels.size() - 1);
+  glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureLoader::finish() {
+  while (pendingCount > 0) {
+    if (update() == 0)
+      std::this_thread::yield();
+  }
+}
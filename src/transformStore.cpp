@@ -0,0 +1,212 @@
+#include "transformStore.h"
+#include "jobSystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_SSE2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// glm::mat4_cast with each rotation column scaled, same operation order so
+// both paths give the same bits
+void composeScalar(float x, float y, float z, float w, float px, float py,
+                   float pz, float sx, float sy, float sz, float *out) {
+  float xx = x * x, yy = y * y, zz = z * z;
+  float xy = x * y, xz = x * z, yz = y * z;
+  float wx = w * x, wy = w * y, wz = w * z;
+
+  out[0] = (1.0f - 2.0f * (yy + zz)) * sx;
+  out[1] = (2.0f * (xy + wz)) * sx;
+  out[2] = (2.0f * (xz - wy)) * sx;
+  out[3] = 0.0f;
+  out[4] = (2.0f * (xy - wz)) * sy;
+  out[5] = (1.0f - 2.0f * (xx + zz)) * sy;
+  out[6] = (2.0f * (yz + wx)) * sy;
+  out[7] = 0.0f;
+  out[8] = (2.0f * (xz + wy)) * sz;
+  out[9] = (2.0f * (yz - wx)) * sz;
+  out[10] = (1.0f - 2.0f * (xx + yy)) * sz;
+  out[11] = 0.0f;
+  out[12] = px;
+  out[13] = py;
+  out[14] = pz;
+  out[15] = 1.0f;
+}
+
+} // namespace
+
+uint32_t TransformStore::add(const glm::vec3 &position,
+                             const glm::quat &rotation,
+                             const glm::vec3 &scale) {
+  uint32_t index = (uint32_t)size();
+  positionX.push_back(position.x);
+  positionY.push_back(position.y);
+  positionZ.push_back(position.z);
+  rotationX.push_back(rotation.x);
+  rotationY.push_back(rotation.y);
+  rotationZ.push_back(rotation.z);
+  rotationW.push_back(rotation.w);
+  scaleX.push_back(scale.x);
+  scaleY.push_back(scale.y);
+  scaleZ.push_back(scale.z);
+  worlds.push_back(glm::mat4(1.0f));
+  dirty.push_back(0);
+  markDirty(index);
+  return index;
+}
+
+void TransformStore::clear() {
+  positionX.clear();
+  positionY.clear();
+  positionZ.clear();
+  rotationX.clear();
+  rotationY.clear();
+  rotationZ.clear();
+  rotationW.clear();
+  scaleX.clear();
+  scaleY.clear();
+  scaleZ.clear();
+  worlds.clear();
+  dirty.clear();
+  dirtyTotal = 0;
+}
+
+glm::vec3 TransformStore::position(uint32_t index) const {
+  return glm::vec3(positionX[index], positionY[index], positionZ[index]);
+}
+
+glm::quat TransformStore::rotation(uint32_t index) const {
+  return glm::quat(rotationW[index], rotationX[index], rotationY[index],
+                   rotationZ[index]);
+}
+
+glm::vec3 TransformStore::scale(uint32_t index) const {
+  return glm::vec3(scaleX[index], scaleY[index], scaleZ[index]);
+}
+
+void TransformStore::setPosition(uint32_t index, const glm::vec3 &position) {
+  positionX[index] = position.x;
+  positionY[index] = position.y;
+  positionZ[index] = position.z;
+  markDirty(index);
+}
+
+void TransformStore::setRotation(uint32_t index, const glm::quat &rotation) {
+  rotationX[index] = rotation.x;
+  rotationY[index] = rotation.y;
+  rotationZ[index] = rotation.z;
+  rotationW[index] = rotation.w;
+  markDirty(index);
+}
+
+void TransformStore::setScale(uint32_t index, const glm::vec3 &scale) {
+  scaleX[index] = scale.x;
+  scaleY[index] = scale.y;
+  scaleZ[index] = scale.z;
+  markDirty(index);
+}
+
+void TransformStore::markDirty(uint32_t index) {
+  if (!dirty[index]) {
+    dirty[index] = 1;
+    dirtyTotal++;
+  }
+}
+
+size_t TransformStore::update(JobSystem *jobs) {
+  size_t updated = dirtyTotal;
+  if (updated == 0)
+    return 0;
+
+  size_t count = size();
+  if (!jobs || count <= PARALLEL_GRAIN) {
+    updateRange(0, count);
+  } else {
+    // split in batches of four so every range starts on a whole batch
+    size_t batches = (count + 3) / 4;
+    jobs->parallelFor(0, batches, PARALLEL_GRAIN / 4,
+                      [this, count](size_t first, size_t last) {
+                        updateRange(first * 4, std::min(last * 4, count));
+                      });
+  }
+
+  dirtyTotal = 0;
+  return updated;
+}
+
+void TransformStore::updateRange(size_t begin, size_t end) {
+  size_t i = begin;
+#ifdef TRANSFORM_SSE2
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= end; i += 4) {
+    // skip batches where nothing moved
+    uint32_t flags;
+    std::memcpy(&flags, &dirty[i], sizeof(flags));
+    if (!flags)
+      continue;
+    std::memset(&dirty[i], 0, 4);
+
+    __m128 x = _mm_loadu_ps(&rotationX[i]);
+    __m128 y = _mm_loadu_ps(&rotationY[i]);
+    __m128 z = _mm_loadu_ps(&rotationZ[i]);
+    __m128 w = _mm_loadu_ps(&rotationW[i]);
+    __m128 sx = _mm_loadu_ps(&scaleX[i]);
+    __m128 sy = _mm_loadu_ps(&scaleY[i]);
+    __m128 sz = _mm_loadu_ps(&scaleZ[i]);
+
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+    // column c, row r of all four matrices
+    __m128 c0r0 = _mm_mul_ps(
+        _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+    __m128 c0r1 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+    __m128 c0r2 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+    __m128 c1r0 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+    __m128 c1r1 = _mm_mul_ps(
+        _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+    __m128 c1r2 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+    __m128 c2r0 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+    __m128 c2r1 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+    __m128 c2r2 = _mm_mul_ps(
+        _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+    __m128 c3r0 = _mm_loadu_ps(&positionX[i]);
+    __m128 c3r1 = _mm_loadu_ps(&positionY[i]);
+    __m128 c3r2 = _mm_loadu_ps(&positionZ[i]);
+    __m128 c0r3 = zero, c1r3 = zero, c2r3 = zero, c3r3 = one;
+
+    // after the transposes register k holds that column of matrix k
+    _MM_TRANSPOSE4_PS(c0r0, c0r1, c0r2, c0r3);
+    _MM_TRANSPOSE4_PS(c1r0, c1r1, c1r2, c1r3);
+    _MM_TRANSPOSE4_PS(c2r0, c2r1, c2r2, c2r3);
+    _MM_TRANSPOSE4_PS(c3r0, c3r1, c3r2, c3r3);
+    __m128 columns[4][4] = {{c0r0, c1r0, c2r0, c3r0},
+                            {c0r1, c1r1, c2r1, c3r1},
+                            {c0r2, c1r2, c2r2, c3r2},
+                            {c0r3, c1r3, c2r3, c3r3}};
+    for (int k = 0; k < 4; k++) {
+      float *out = &worlds[i + k][0][0];
+      _mm_storeu_ps(out, columns[k][0]);
+      _mm_storeu_ps(out + 4, columns[k][1]);
+      _mm_storeu_ps(out + 8, columns[k][2]);
+      _mm_storeu_ps(out + 12, columns[k][3]);
+    }
+  }
+#endif
+  for (; i < end; i++) {
+    if (!dirty[i])
+      continue;
+    dirty[i] = 0;
+    composeScalar(rotationX[i], rotationY[i], rotationZ[i], rotationW[i],
+                  positionX[i], positionY[i], positionZ[i], scaleX[i],
+                  scaleY[i], scaleZ[i], &worlds[i][0][0]);
+  }
+}
@@ -0,0 +1,75 @@
+// Asset packer: stores files under their base names in one pack that the
+// runtime maps instead of opening loose files, see AssetPack.
+#include "assetPack.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+void usage(const char *program) {
+  std::cerr << "Usage: " << program << " [--lz4] OUTPUT FILE..." << std::endl;
+}
+
+// KTX2 levels are already block compressed and are uploaded straight
+// from the mapping, so they are never LZ4 compressed
+bool readInPlace(const std::string &name) {
+  const std::string extension = ".ktx2";
+  return name.size() >= extension.size() &&
+         name.compare(name.size() - extension.size(), extension.size(),
+                      extension) == 0;
+}
+
+std::string baseName(const std::string &path) {
+  size_t slash = path.find_last_of("/\\");
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool lz4 = false;
+  const char *output = nullptr;
+  std::vector<AssetPackInput> inputs;
+  size_t looseBytes = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--lz4") == 0) {
+      lz4 = true;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return -1;
+    } else if (!output) {
+      output = argv[i];
+    } else {
+      std::ifstream file(argv[i], std::ios::binary);
+      if (!file) {
+        std::cerr << "Failed to read " << argv[i] << std::endl;
+        return -1;
+      }
+      AssetPackInput input;
+      input.name = baseName(argv[i]);
+      input.compress = !readInPlace(input.name);
+      input.bytes.assign(std::istreambuf_iterator<char>(file),
+                         std::istreambuf_iterator<char>());
+      looseBytes += input.bytes.size();
+      inputs.push_back(std::move(input));
+    }
+  }
+  if (!output || inputs.empty()) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  if (!writeAssetPack(output, inputs, lz4))
+    return -1;
+  std::ifstream written(output, std::ios::binary | std::ios::ate);
+  std::cout << output << ": " << inputs.size() << " assets, " << looseBytes
+            << " bytes loose, " << (size_t)written.tellg() << " packed"
+            << std::endl;
+  return 0;
+}
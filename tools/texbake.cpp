@@ -0,0 +1,158 @@
+// Offline texture baker: decodes an image, builds its mip chain and writes
+// one KTX2 file per block compressed format, <prefix>.<format>.ktx2. The
+// runtime picks the best of them the GPU supports, see TextureLoader.
+#include "ktx2.h"
+#include "stb_image.h"
+#include "textureCompression.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// below this a round trip is reported as failed
+const double MIN_PSNR = 30.0;
+
+void usage(const char *program) {
+  std::cerr << "Usage: " << program
+            << " [--flip] [--formats bc1,bc3,bc7,etc2,etc2a] [--verify]"
+            << " INPUT OUTPUT_PREFIX" << std::endl
+            << "Without --formats, opaque images get bc7, bc1 and etc2,"
+            << " images with alpha bc7, bc3 and etc2a" << std::endl;
+}
+
+bool parseFormats(const char *list, std::vector<BlockFormat> &formats) {
+  std::string names = list;
+  size_t start = 0;
+  while (start <= names.size()) {
+    size_t end = names.find(',', start);
+    if (end == std::string::npos)
+      end = names.size();
+    BlockFormat format;
+    if (!parseBlockFormat(names.substr(start, end - start).c_str(), format)) {
+      std::cerr << "Unknown format " << names.substr(start, end - start)
+                << std::endl;
+      return false;
+    }
+    formats.push_back(format);
+    start = end + 1;
+  }
+  return true;
+}
+
+// alpha moved into red, so psnr() can compare it alone
+Image alphaOnly(const Image &image) {
+  Image alpha = image;
+  for (size_t i = 0; i < alpha.rgba.size(); i += 4)
+    alpha.rgba[i] = alpha.rgba[i + 3];
+  return alpha;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool flip = false;
+  bool verify = false;
+  std::vector<BlockFormat> formats;
+  const char *input = nullptr;
+  const char *prefix = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--flip") == 0) {
+      flip = true;
+    } else if (std::strcmp(argv[i], "--verify") == 0) {
+      verify = true;
+    } else if (std::strcmp(argv[i], "--formats") == 0 && i + 1 < argc) {
+      if (!parseFormats(argv[++i], formats))
+        return -1;
+    } else if (!input && argv[i][0] != '-') {
+      input = argv[i];
+    } else if (!prefix && argv[i][0] != '-') {
+      prefix = argv[i];
+    } else {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  if (!input || !prefix) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  stbi_set_flip_vertically_on_load(flip);
+  int width, height, channels;
+  unsigned char *pixels = stbi_load(input, &width, &height, &channels, 4);
+  if (!pixels) {
+    std::cerr << "Failed to load " << input << std::endl;
+    return -1;
+  }
+  Image source;
+  source.width = (uint32_t)width;
+  source.height = (uint32_t)height;
+  source.rgba.assign(pixels, pixels + (size_t)width * height * 4);
+  stbi_image_free(pixels);
+
+  const bool hasAlpha = channels == 2 || channels == 4;
+  if (formats.empty()) {
+    formats.push_back(BlockFormat::Bc7);
+    formats.push_back(hasAlpha ? BlockFormat::Bc3 : BlockFormat::Bc1);
+    formats.push_back(hasAlpha ? BlockFormat::Etc2Rgba
+                               : BlockFormat::Etc2Rgb);
+  }
+
+  std::vector<Image> mips = buildMipChain(source);
+  int result = 0;
+  for (BlockFormat format : formats) {
+    auto start = std::chrono::steady_clock::now();
+    Ktx2Texture texture;
+    texture.format = format;
+    texture.width = source.width;
+    texture.height = source.height;
+    texture.orientation = flip ? "ru" : "rd";
+    for (const Image &mip : mips)
+      texture.levels.push_back(compressImage(format, mip));
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    std::string path =
+        std::string(prefix) + "." + blockFormatName(format) + ".ktx2";
+    if (!writeKtx2(path, texture))
+      return -1;
+
+    size_t bytes = 0;
+    for (const std::vector<uint8_t> &level : texture.levels)
+      bytes += level.size();
+    std::cout << path << ": " << mips.size() << " levels, " << bytes
+              << " bytes, " << std::fixed << std::setprecision(1) << ms
+              << " ms";
+
+    // decode what was written back and compare it with the source
+    if (verify) {
+      Ktx2Texture loaded;
+      if (!readKtx2(path, loaded))
+        return -1;
+      Image decoded = decompressImage(format, loaded.levels[0].data(),
+                                      loaded.width, loaded.height);
+      double colorPsnr = psnr(source, decoded, 3);
+      std::cout << ", RGB " << std::setprecision(2) << colorPsnr << " dB";
+      bool passed = colorPsnr >= MIN_PSNR;
+      if (hasAlpha && blockFormatHasAlpha(format)) {
+        double alphaPsnr = psnr(alphaOnly(source), alphaOnly(decoded), 1);
+        std::cout << ", alpha " << alphaPsnr << " dB";
+        passed = passed && alphaPsnr >= MIN_PSNR;
+      }
+      if (!passed) {
+        std::cout << " BELOW " << MIN_PSNR << " dB";
+        result = 1;
+      }
+    }
+    std::cout << std::endl;
+  }
+  return result;
+}